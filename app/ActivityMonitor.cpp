@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <ActivityMonitor.hpp>
+
+ActivityMonitor::ActivityMonitor(int n_contexts) : m_contexts(n_contexts)
+{
+}
+
+// Signals must all be added before the first sample()
+int ActivityMonitor::addSignal(const char* name, int width, Probe probe)
+{
+    if (m_usedBits + width > 64)
+    {
+        m_fields.push_back(std::vector<Field>());
+        m_prev.push_back(0);
+        m_curr.push_back(0);
+        m_usedBits = 0;
+    }
+
+    Signal sig;
+    sig.name = name;
+    sig.width = width;
+    sig.probe = probe;
+    sig.word = (int)m_fields.size() - 1;
+    sig.shift = m_usedBits;
+    m_signals.push_back(sig);
+
+    int id = (int)m_signals.size() - 1;
+    uint64_t mask = (width >= 64) ? ~0ULL : ((1ULL << width) - 1);
+    m_fields[sig.word].push_back(Field{id, sig.shift, mask});
+    m_usedBits += width;
+    return id;
+}
+
+// Add the open run of signal to the current context
+void ActivityMonitor::settle(int signal)
+{
+    m_counts[m_context * m_signals.size() + signal].ones += (uint64_t)m_level[signal] * (m_total - m_since[signal]);
+    m_since[signal] = m_total;
+}
+
+void ActivityMonitor::sample(int context)
+{
+    if (m_counts.empty())
+    {
+        m_counts.resize(m_contexts * m_signals.size());
+        m_samples.resize(m_contexts, 0);
+        m_level.resize(m_signals.size(), 0);
+        m_since.resize(m_signals.size(), 0);
+        m_context = context;
+    }
+
+    if (context != m_context)
+    {
+        for (size_t s = 0; s < m_signals.size(); s++)
+        {
+            settle((int)s);
+        }
+        m_context = context;
+    }
+
+    // Pack
+    for (uint64_t& w : m_curr)
+    {
+        w = 0;
+    }
+    for (const Signal& sig : m_signals)
+    {
+        uint64_t mask = (sig.width >= 64) ? ~0ULL : ((1ULL << sig.width) - 1);
+        m_curr[sig.word] |= ((uint64_t)sig.probe() & mask) << sig.shift;
+    }
+
+    Counts* counts = &m_counts[context * m_signals.size()];
+    m_samples[context]++;
+
+    for (size_t w = 0; w < m_curr.size(); w++)
+    {
+        uint64_t curr = m_curr[w];
+        uint64_t diff = m_primed ? (curr ^ m_prev[w]) : ~0ULL;
+
+        if (diff != 0)
+        {
+            for (const Field& f : m_fields[w])
+            {
+                uint64_t changed = (diff >> f.shift) & f.mask;
+                if (changed == 0)
+                {
+                    continue;
+                }
+                settle(f.signal);
+                m_level[f.signal] = __builtin_popcountll((curr >> f.shift) & f.mask);
+                if (m_primed)
+                {
+                    counts[f.signal].toggles += __builtin_popcountll(changed);
+                }
+            }
+        }
+        m_prev[w] = curr;
+    }
+    m_primed = true;
+    m_total++;
+}
+
+// ==============================================
+// Results
+
+uint64_t ActivityMonitor::toggles(int signal) const
+{
+    uint64_t n = 0;
+    for (int c = 0; c < m_contexts && !m_counts.empty(); c++)
+    {
+        n += at(c, signal).toggles;
+    }
+    return n;
+}
+
+double ActivityMonitor::duty(int signal) const
+{
+    uint64_t high = 0;
+    uint64_t samples = 0;
+    for (int c = 0; c < m_contexts && !m_counts.empty(); c++)
+    {
+        high += ones(c, signal);
+        samples += m_samples[c];
+    }
+    return samples ? (double)high / ((double)samples * m_signals[signal].width) : 0;
+}
+
+void ActivityMonitor::writeCsv(FILE* file, const char* const* context_names) const
+{
+    fprintf(file, "scope,signal,width,samples,toggles,toggles_per_sample,duty\n");
+
+    uint64_t total_samples = 0;
+    for (uint64_t n : m_samples)
+    {
+        total_samples += n;
+    }
+
+    for (size_t s = 0; s < m_signals.size(); s++)
+    {
+        const Signal& sig = m_signals[s];
+        uint64_t t = toggles((int)s);
+        fprintf(file, "all,%s,%d,%llu,%llu,%.6f,%.6f\n", sig.name.c_str(), sig.width,
+                (unsigned long long)total_samples, (unsigned long long)t,
+                total_samples ? (double)t / total_samples : 0.0, duty((int)s));
+    }
+
+    for (int c = 0; c < m_contexts && !m_counts.empty(); c++)
+    {
+        uint64_t samples = m_samples[c];
+        if (samples == 0)
+        {
+            continue;
+        }
+        for (size_t s = 0; s < m_signals.size(); s++)
+        {
+            const Signal& sig = m_signals[s];
+            const Counts& k = at(c, (int)s);
+            if (context_names)
+            {
+                fprintf(file, "%s,", context_names[c]);
+            }
+            else
+            {
+                fprintf(file, "%d,", c);
+            }
+            fprintf(file, "%s,%d,%llu,%llu,%.6f,%.6f\n", sig.name.c_str(), sig.width,
+                    (unsigned long long)samples, (unsigned long long)k.toggles,
+                    (double)k.toggles / samples, (double)ones(c, (int)s) / ((double)samples * sig.width));
+        }
+    }
+}
+
+void ActivityMonitor::writeJson(FILE* file, const char* const* context_names) const
+{
+    fprintf(file, "{\n  \"signals\": [\n");
+    for (size_t s = 0; s < m_signals.size(); s++)
+    {
+        const Signal& sig = m_signals[s];
+        fprintf(file, "    {\"name\": \"%s\", \"width\": %d, \"toggles\": %llu, \"duty\": %.6f}%s\n",
+                sig.name.c_str(), sig.width, (unsigned long long)toggles((int)s), duty((int)s),
+                (s + 1 < m_signals.size()) ? "," : "");
+    }
+    fprintf(file, "  ],\n  \"profiles\": {");
+
+    bool first = true;
+    for (int c = 0; c < m_contexts && !m_counts.empty(); c++)
+    {
+        if (m_samples[c] == 0)
+        {
+            continue;
+        }
+        if (context_names)
+        {
+            fprintf(file, "%s\n    \"%s\": {\"samples\": %llu, \"toggles\": {", first ? "" : ",",
+                    context_names[c], (unsigned long long)m_samples[c]);
+        }
+        else
+        {
+            fprintf(file, "%s\n    \"%d\": {\"samples\": %llu, \"toggles\": {", first ? "" : ",",
+                    c, (unsigned long long)m_samples[c]);
+        }
+        for (size_t s = 0; s < m_signals.size(); s++)
+        {
+            fprintf(file, "%s\"%s\": %llu", s ? ", " : "", m_signals[s].name.c_str(),
+                    (unsigned long long)at(c, (int)s).toggles);
+        }
+        fprintf(file, "}}");
+        first = false;
+    }
+    fprintf(file, "\n  }\n}\n");
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Switching activity statistics
+
+    Every monitored signal (a node is 1 bit, a bus 8) owns a bit field in a
+    packed state vector. Each step the new vector is XORed with the last one,
+    and only words that changed are walked field by field: the toggles are
+    popcounted and the field's duty is settled, its old popcount times the
+    samples it was held. A quiet step costs one compare per word. Counts
+    are kept per context, the current instruction's opcode in app.cpp, to
+    give activity profiles; a context switch settles every field once.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ActivityMonitor
+{
+public:
+    typedef std::function<uint32_t()> Probe;
+
+    explicit ActivityMonitor(int n_contexts = 1);
+
+    // width <= 32, fields never straddle a word
+    int addSignal(const char* name, int width, Probe probe);
+
+    void sample(int context = 0);
+
+    uint64_t toggles(int signal) const;
+    double duty(int signal) const;
+
+    // context_names may be null, contexts are then numbered
+    void writeCsv(FILE* file, const char* const* context_names = nullptr) const;
+    void writeJson(FILE* file, const char* const* context_names = nullptr) const;
+
+private:
+    struct Field
+    {
+        int signal;
+        int shift;
+        uint64_t mask;
+    };
+
+    struct Signal
+    {
+        std::string name;
+        int width;
+        Probe probe;
+        int word;
+        int shift;
+    };
+
+    struct Counts
+    {
+        uint64_t toggles {0};
+        uint64_t ones {0};
+    };
+
+    const Counts& at(int context, int signal) const
+    {
+        return m_counts[context * m_signals.size() + signal];
+    }
+
+    // Settled ones plus the run still open in the current context
+    uint64_t ones(int context, int signal) const
+    {
+        uint64_t n = at(context, signal).ones;
+        if (context == m_context)
+        {
+            n += (uint64_t)m_level[signal] * (m_total - m_since[signal]);
+        }
+        return n;
+    }
+
+    void settle(int signal);
+
+    std::vector<Signal> m_signals;
+    std::vector<std::vector<Field>> m_fields;   // per word
+    std::vector<uint64_t> m_prev;
+    std::vector<uint64_t> m_curr;
+    int m_usedBits {64};                        // bits used in the last word
+
+    int m_contexts;
+    std::vector<Counts> m_counts;               // [context][signal]
+    std::vector<uint64_t> m_samples;            // per context
+    bool m_primed {false};
+
+    // Duty runs, per signal
+    std::vector<uint32_t> m_level;              // ones in the current value
+    std::vector<uint64_t> m_since;              // first sample not yet counted
+    uint64_t m_total {0};
+    int m_context {0};
+};
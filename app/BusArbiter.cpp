@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <BusArbiter.hpp>
+
+using namespace DCSim;
+
+BusArbiter::BusArbiter(int n_ports)
+    : m_n(n_ports), m_ports(new Port[n_ports])
+{
+    for (int i = 0; i < m_n; i++)
+    {
+        Port& p = m_ports[i];
+        add_pin(&p.request);
+        for (int b = 0; b < N_BUS_BITS; b++)
+        {
+            add_pin(&p.addr[b]);
+            add_pin(&p.data[b]);
+            p.data[b].set_state(kHighZ);
+        }
+    }
+    for (int b = 0; b < N_BUS_BITS; b++)
+    {
+        add_pin(&addr_out[b]);
+        add_pin(&data_in[b]);
+    }
+    add_pin(&OutputEnable);
+    OutputEnable.set_value(kLogicHigh);
+}
+
+void BusArbiter::evaluate()
+{
+    steps++;
+
+    // Requests
+    int requests = 0;
+    for (int i = 0; i < m_n; i++)
+    {
+        Port& p = m_ports[i];
+        if (p.request.get_value() == kLogicHigh)
+        {
+            requests++;
+            p.stats.requestSteps++;
+        }
+    }
+    if (requests == 0)
+    {
+        idleSteps++;
+    }
+    else if (requests > 1)
+    {
+        contendedSteps++;
+    }
+
+    // Owner keeps the bus until it drops its request
+    if ((m_owner >= 0) && (m_ports[m_owner].request.get_value() != kLogicHigh))
+    {
+        m_last = m_owner;
+        m_owner = -1;
+    }
+
+    if (m_owner < 0)
+    {
+        for (int k = 1; k <= m_n; k++)
+        {
+            int i = (m_last + k) % m_n;
+            if (m_ports[i].request.get_value() == kLogicHigh)
+            {
+                m_owner = i;
+                m_held = 0;
+                m_ports[i].stats.grants++;
+                break;
+            }
+        }
+    }
+    else
+    {
+        m_held++;
+    }
+
+    // Wait accounting
+    for (int i = 0; i < m_n; i++)
+    {
+        Port& p = m_ports[i];
+        if (p.request.get_value() != kLogicHigh)
+        {
+            p.wait = 0;
+        }
+        else if (stalled(i))
+        {
+            p.wait++;
+            p.stats.waitSteps++;
+            if (p.wait > p.stats.maxWait)
+            {
+                p.stats.maxWait = p.wait;
+            }
+        }
+        else
+        {
+            p.wait = 0;
+        }
+    }
+
+    // Route the owner to memory
+    if (m_owner >= 0)
+    {
+        Port& p = m_ports[m_owner];
+        for (int b = 0; b < N_BUS_BITS; b++)
+        {
+            addr_out[b].set_value(p.addr[b].get_value());
+        }
+    }
+    OutputEnable.set_value((m_owner >= 0) ? kLogicLow : kLogicHigh);
+
+    for (int i = 0; i < m_n; i++)
+    {
+        Port& p = m_ports[i];
+        for (int b = 0; b < N_BUS_BITS; b++)
+        {
+            if (i == m_owner)
+            {
+                p.data[b].set_state(kOutput);
+                p.data[b].set_value(data_in[b].get_value());
+            }
+            else
+            {
+                p.data[b].set_state(kHighZ);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Round robin memory bus arbiter
+
+    Sits between several CPUs and one shared memory. Each port has a
+    request input (the core's Mem_Out), an address input on the core's
+    marBus and tri-state data outputs on the core's mainBus. The owner
+    keeps the bus for as long as it holds its request, then the next
+    requester after it wins.
+
+    The owner's address goes out on addr_out and the memory's data comes
+    back on data_in and is driven onto the owner's data pins only. Cores
+    that request without the grant are stalled, the system gates their
+    clock, and so is a new owner until its data has had settleSteps()
+    evaluations to reach its bus. The owner derives that from its step
+    order, see Sap2System.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <sim.hpp>
+
+struct ArbiterStats
+{
+    uint64_t grants {0};
+    uint64_t requestSteps {0};      // steps with the request held
+    uint64_t waitSteps {0};         // of those, without the grant
+    uint64_t maxWait {0};           // longest wait for one grant, in steps
+};
+
+class BusArbiter : public DCSim::Component
+{
+public:
+    struct Port
+    {
+        DCSim::InputPin request;
+        DCSim::InputPin addr[N_BUS_BITS];
+        DCSim::TriStatePin data[N_BUS_BITS];
+        DCSim::pinGroup_t addr_pins {N_BUS_BITS, addr};
+        DCSim::pinGroup_t data_pins {N_BUS_BITS, data};
+
+        ArbiterStats stats;
+        uint64_t wait {0};
+    };
+
+    explicit BusArbiter(int n_ports);
+
+    void evaluate();
+
+    // Steps from a grant until the memory's data is on the owner's bus
+    void setSettleSteps(int steps) { m_settle = (uint64_t)steps; }
+    int settleSteps() const { return (int)m_settle; }
+
+    // Holding a request without a settled grant
+    bool stalled(int port) const
+    {
+        const Port& p = m_ports[port];
+        return (p.request.get_value() == DCSim::kLogicHigh) &&
+               !((m_owner == port) && (m_held >= m_settle));
+    }
+
+    int owner() const { return m_owner; }
+    int ports() const { return m_n; }
+    Port& port(int i) { return m_ports[i]; }
+    const Port& port(int i) const { return m_ports[i]; }
+
+    // Memory side
+    DCSim::OutputPin addr_out[N_BUS_BITS];
+    DCSim::InputPin data_in[N_BUS_BITS];
+    DCSim::pinGroup_t addr_out_pins {N_BUS_BITS, addr_out};
+    DCSim::pinGroup_t data_in_pins {N_BUS_BITS, data_in};
+
+    // To the memory's OutputEnable, active low
+    DCSim::OutputPin OutputEnable;
+
+    uint64_t steps {0};
+    uint64_t contendedSteps {0};    // more than one request
+    uint64_t idleSteps {0};         // no request
+
+private:
+    int m_n;
+    uint64_t m_settle {0};
+    std::unique_ptr<Port[]> m_ports;
+
+    int m_owner {-1};
+    int m_last {-1};
+    uint64_t m_held {0};
+};
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <Elaborator.hpp>
+
+using namespace DCSim;
+
+static const char* kindName(Elaborator::Kind_E_t kind)
+{
+    switch (kind)
+    {
+        case Elaborator::kRail:             return "rail";
+        case Elaborator::kNode:             return "node";
+        case Elaborator::kInverter:         return "inverter";
+        case Elaborator::kCombinational:    return "logic";
+        case Elaborator::kSequential:       return "sequential";
+    }
+    return "?";
+}
+
+static char valueChar(PinValue_E_t value)
+{
+    if (value == kLogicLow)
+    {
+        return '0';
+    }
+    if (value == kLogicHigh)
+    {
+        return '1';
+    }
+    return 'Z';
+}
+
+// ==============================================
+// Netlist description
+
+int Elaborator::add(const Element& e)
+{
+    m_elements.push_back(e);
+    return (int)m_elements.size() - 1;
+}
+
+void Elaborator::addPin(Pin* pin, int element, Role_E_t role, const char* name, int bit, PinValue_E_t active)
+{
+    m_pinIndex[pin] = m_pins.size();
+    m_pins.push_back(PinRole{pin, element, role, name, bit, active});
+}
+
+void Elaborator::addRail(Pin* pin, const char* name, PinValue_E_t value)
+{
+    Element e;
+    e.name = name;
+    e.kind = kRail;
+    e.value = value;
+    addPin(pin, add(e), kRoleRail, name, -1, value);
+}
+
+int Elaborator::addNode(LazyNode* node, const char* name)
+{
+    Element e;
+    e.name = name;
+    e.kind = kNode;
+    e.node = node;
+    return add(e);
+}
+
+int Elaborator::addPart(Component* part, const char* name, Kind_E_t kind)
+{
+    Element e;
+    e.name = name;
+    e.kind = kind;
+    e.part = part;
+    return add(e);
+}
+
+void Elaborator::input(int part, Pin* pin, const char* name)
+{
+    addPin(pin, part, kRoleInput, name, -1, kPinValMax);
+}
+
+void Elaborator::input(int part, const pinGroup_t& group, const char* name)
+{
+    for (int i = 0; i < group.num_pins; i++)
+    {
+        addPin(&group.pins[i], part, kRoleInput, name, i, kPinValMax);
+    }
+}
+
+void Elaborator::output(int part, Pin* pin)
+{
+    addPin(pin, part, kRoleOutput, "", -1, kPinValMax);
+}
+
+void Elaborator::output(int part, const pinGroup_t& group)
+{
+    for (int i = 0; i < group.num_pins; i++)
+    {
+        addPin(&group.pins[i], part, kRoleOutput, "", i, kPinValMax);
+    }
+}
+
+void Elaborator::enable(int part, Pin* pin, const char* name, PinValue_E_t active)
+{
+    addPin(pin, part, kRoleEnable, name, -1, active);
+}
+
+// ==============================================
+// Linking
+
+void Elaborator::link()
+{
+    // Node drivers: rails, part outputs, or anything undescribed
+    std::map<const Pin*, int> on_node;
+    for (size_t i = 0; i < m_elements.size(); i++)
+    {
+        Element& e = m_elements[i];
+        if (e.kind != kNode)
+        {
+            continue;
+        }
+        if (e.node->pins().empty())
+        {
+            e.unconnected = true;
+            continue;
+        }
+
+        for (Pin* pin : e.node->pins())
+        {
+            on_node[pin] = (int)i;
+
+            std::map<const Pin*, size_t>::const_iterator it = m_pinIndex.find(pin);
+            if (it == m_pinIndex.end())
+            {
+                e.inputs.push_back(Input{kUnknown, "", -1, false, kPinValMax});
+                continue;
+            }
+
+            const PinRole& role = m_pins[it->second];
+            if (role.role == kRoleRail || role.role == kRoleOutput)
+            {
+                e.inputs.push_back(Input{role.element, "", -1, false, kPinValMax});
+            }
+        }
+    }
+
+    // Part inputs, in the order they were described
+    for (const PinRole& role : m_pins)
+    {
+        if (role.role != kRoleInput && role.role != kRoleEnable)
+        {
+            continue;
+        }
+
+        std::map<const Pin*, int>::const_iterator it = on_node.find(role.pin);
+        int from = (it == on_node.end()) ? kUnknown : it->second;
+        m_elements[role.element].inputs.push_back(
+            Input{from, role.name, role.bit, role.role == kRoleEnable, role.active});
+    }
+}
+
+void Elaborator::trackDrivers(LazyDrivers& drivers) const
+{
+    for (const Element& e : m_elements)
+    {
+        if (e.kind != kNode || e.constant)
+        {
+            continue;
+        }
+
+        for (Pin* pin : e.node->pins())
+        {
+            std::map<const Pin*, size_t>::const_iterator it = m_pinIndex.find(pin);
+            if (it == m_pinIndex.end())
+            {
+                continue;
+            }
+
+            if (m_pins[it->second].role == kRoleOutput)
+            {
+                drivers.add(pin, e.node);
+            }
+            else
+            {
+                e.node->unpoll(pin);
+            }
+        }
+    }
+}
+
+// ==============================================
+// Constant propagation
+
+void Elaborator::elaborate()
+{
+    link();
+
+    int order = 0;
+    for (Element& e : m_elements)
+    {
+        if (e.kind == kRail || e.unconnected)
+        {
+            e.constant = true;
+            e.order = order++;
+            m_folded += e.unconnected ? 1 : 0;
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (Element& e : m_elements)
+        {
+            if (e.constant || e.kind == kSequential || e.inputs.empty())
+            {
+                continue;
+            }
+
+            bool all_const = true;
+            bool dead = false;
+            for (const Input& in : e.inputs)
+            {
+                if (in.from == kUnknown)
+                {
+                    all_const = false;
+                    continue;
+                }
+                const Element& src = m_elements[in.from];
+                if (!src.constant)
+                {
+                    all_const = false;
+                    continue;
+                }
+                if (in.isEnable && src.value != kPinValMax && src.value != in.active)
+                {
+                    dead = true;
+                }
+            }
+
+            if (dead && e.kind != kNode)
+            {
+                e.disabled = true;
+                e.value = kPinValMax;
+            }
+            else if (all_const)
+            {
+                const Element& src = m_elements[e.inputs[0].from];
+                if (e.kind == kNode && e.inputs.size() == 1)
+                {
+                    e.value = src.value;
+                }
+                else if (e.kind == kInverter && src.value != kPinValMax)
+                {
+                    e.value = (src.value == kLogicHigh) ? kLogicLow : kLogicHigh;
+                }
+            }
+            else
+            {
+                continue;
+            }
+
+            e.constant = true;
+            e.order = order++;
+            m_folded++;
+            changed = true;
+        }
+    }
+}
+
+// ==============================================
+// Pruning
+
+void Elaborator::settle()
+{
+    std::vector<const Element*> settled;
+    for (const Element& e : m_elements)
+    {
+        if (e.constant)
+        {
+            settled.push_back(&e);
+        }
+    }
+    std::sort(settled.begin(), settled.end(),
+              [](const Element* a, const Element* b) { return a->order < b->order; });
+
+    // Input pins keep the value they are given, one pass is enough
+    for (const Element* e : settled)
+    {
+        if (e->node)
+        {
+            e->node->evaluate();
+            m_prunedNodes.push_back(e->node);
+        }
+        if (e->part)
+        {
+            e->part->evaluate();
+            m_prunedParts.push_back(e->part);
+        }
+    }
+}
+
+void Elaborator::report() const
+{
+    printf(" = = = Elaboration = = = \n");
+    printf("Nodes: %zu -> %zu |\t Parts: %zu -> %zu |\t Folded: %d\n",
+           m_nodesBefore, m_nodesAfter, m_partsBefore, m_partsAfter, m_folded);
+
+    for (const Element& e : m_elements)
+    {
+        if (!e.constant)
+        {
+            continue;
+        }
+        if (e.unconnected)
+        {
+            printf("Pruned: %-12s | %-10s | unconnected\n", e.name.c_str(), kindName(e.kind));
+        }
+        else if (e.disabled)
+        {
+            printf("Pruned: %-12s | %-10s | disabled\n", e.name.c_str(), kindName(e.kind));
+        }
+        else
+        {
+            printf("Pruned: %-12s | %-10s | %c\n", e.name.c_str(), kindName(e.kind), valueChar(e.value));
+        }
+    }
+
+    // Live elements that still see tied inputs
+    for (const Element& e : m_elements)
+    {
+        if (e.constant)
+        {
+            continue;
+        }
+        for (size_t k = 0; k < e.inputs.size(); k++)
+        {
+            const Input& in = e.inputs[k];
+            if (!tied(in))
+            {
+                continue;
+            }
+
+            char value = valueChar(m_elements[in.from].value);
+            if (in.bit < 0)
+            {
+                printf("Tied:   %s.%s = %c\n", e.name.c_str(), in.pin.c_str(), value);
+                continue;
+            }
+
+            // Consecutive bits of one group tied alike print as A9..A12
+            size_t last = k;
+            while (last + 1 < e.inputs.size())
+            {
+                const Input& next = e.inputs[last + 1];
+                if (!tied(next) || next.pin != in.pin || next.bit != e.inputs[last].bit + 1 ||
+                    valueChar(m_elements[next.from].value) != value)
+                {
+                    break;
+                }
+                last++;
+            }
+
+            if (last == k)
+            {
+                printf("Tied:   %s.%s%d = %c\n", e.name.c_str(), in.pin.c_str(), in.bit, value);
+            }
+            else
+            {
+                printf("Tied:   %s.%s%d..%s%d = %c\n", e.name.c_str(), in.pin.c_str(), in.bit,
+                       in.pin.c_str(), e.inputs[last].bit, value);
+            }
+            k = last;
+        }
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Static elaboration: constant propagation and dead-logic pruning
+
+    The graph is read from the real wiring. Nodes are LazyNodes, which
+    remember every pin they were connect()ed to; parts only declare which
+    of their pins are inputs, outputs and enables, and rails which pins
+    are tied. elaborate() then links each part pin to the node it sits on.
+    Constants start at the rails and flow through nodes and combinational
+    parts. A part is also constant when one of its enables is tied
+    inactive, e.g. a buffer whose OE is grounded only ever drives high-Z.
+
+    Anything not described stays live: a node pin no part owns counts as an
+    unknown driver, and a part input on no node (a bus, or left open) as an
+    unknown input, so neither can ever be folded.
+
+    prune() evaluates the constant elements once, in dependency order, and
+    removes them from the per-step evaluation lists. Sequential parts are
+    never folded, their tied inputs are only listed in the report.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sim.hpp>
+#include <LazyNode.hpp>
+
+class Elaborator
+{
+public:
+    enum Kind_E_t
+    {
+        kRail,
+        kNode,
+        kInverter,          // value known: !input
+        kCombinational,     // value unknown, constant when every input is
+        kSequential         // holds state, never folded
+    };
+
+    // Source or ground pin, a node connected to it is a rail
+    void addRail(DCSim::Pin* pin, const char* name, DCSim::PinValue_E_t value);
+
+    // Connections come from the node, a node with none is pruned
+    int addNode(LazyNode* node, const char* name);
+    int addPart(DCSim::Component* part, const char* name, Kind_E_t kind);
+
+    // Pin roles of a part
+    void input(int part, DCSim::Pin* pin, const char* name);
+    void input(int part, const DCSim::pinGroup_t& group, const char* name);
+    void output(int part, DCSim::Pin* pin);
+    void output(int part, const DCSim::pinGroup_t& group);
+
+    // Enable input, the part is dead (constant) while its node is not at active
+    void enable(int part, DCSim::Pin* pin, const char* name, DCSim::PinValue_E_t active);
+
+    void elaborate();
+
+    // Settle constant elements once and drop them from the step lists
+    template <typename NodeT>
+    void prune(std::vector<NodeT*>& nodes, std::vector<DCSim::Component*>& parts)
+    {
+        m_nodesBefore = nodes.size();
+        m_partsBefore = parts.size();
+        settle();
+
+        for (LazyNode* node : m_prunedNodes)
+        {
+            nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+        }
+        for (DCSim::Component* part : m_prunedParts)
+        {
+            parts.erase(std::remove(parts.begin(), parts.end(), part), parts.end());
+        }
+
+        m_nodesAfter = nodes.size();
+        m_partsAfter = parts.size();
+    }
+
+    void report() const;
+
+    // Hand the pin roles to lazy evaluation: part outputs on live nodes are
+    // watched by drivers, inputs and rails are never polled
+    void trackDrivers(LazyDrivers& drivers) const;
+
+private:
+    // Input whose source is not described, never constant
+    static const int kUnknown = -1;
+
+    struct Input
+    {
+        int from;
+        std::string pin;
+        int bit;                        // index in a pin group, -1 for a single pin
+        bool isEnable;
+        DCSim::PinValue_E_t active;
+    };
+
+    enum Role_E_t
+    {
+        kRoleRail,
+        kRoleInput,
+        kRoleEnable,
+        kRoleOutput
+    };
+
+    struct PinRole
+    {
+        DCSim::Pin* pin;
+        int element;
+        Role_E_t role;
+        std::string name;
+        int bit;
+        DCSim::PinValue_E_t active;
+    };
+
+    struct Element
+    {
+        std::string name;
+        Kind_E_t kind;
+        LazyNode* node {nullptr};
+        DCSim::Component* part {nullptr};
+        std::vector<Input> inputs;
+
+        bool constant {false};
+        bool disabled {false};          // folded by an inactive enable
+        bool unconnected {false};
+        DCSim::PinValue_E_t value {DCSim::kPinValMax};
+        int order {-1};                 // settle order for prune()
+    };
+
+    bool tied(const Input& in) const { return (in.from != kUnknown) && m_elements[in.from].constant; }
+
+    int add(const Element& e);
+    void addPin(DCSim::Pin* pin, int element, Role_E_t role, const char* name, int bit, DCSim::PinValue_E_t active);
+
+    // Turn pin roles and node connections into element inputs
+    void link();
+    void settle();
+
+    std::vector<Element> m_elements;
+    std::vector<PinRole> m_pins;
+    std::map<const DCSim::Pin*, size_t> m_pinIndex;
+    std::vector<LazyNode*> m_prunedNodes;
+    std::vector<DCSim::Component*> m_prunedParts;
+    int m_folded {0};
+    size_t m_nodesBefore {0};
+    size_t m_partsBefore {0};
+    size_t m_nodesAfter {0};
+    size_t m_partsAfter {0};
+};
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <LazyNode.hpp>
+
+using namespace DCSim;
+
+#ifdef LAZY_STATS
+#define LAZY_COUNT(counter, n) ((counter) += (n))
+#else
+#define LAZY_COUNT(counter, n)
+#endif
+
+LazyStats LazyNode::stats;
+LazyStats LazyPinGroup::stats;
+uint64_t LazyPinGroup::s_epoch = 0;
+
+static uint8_t pinCode(Pin& pin)
+{
+    return (uint8_t)((pin.get_state() << 4) | (pin.get_value() & 0x0F));
+}
+
+// ==============================================
+// LazyNode
+
+void LazyNode::connect(Pin* pin)
+{
+    ElectricalNode::connect(pin);
+    m_pins.push_back(pin);
+    m_polledPins.push_back(pin);
+    m_dirty = true;
+}
+
+void LazyNode::unpoll(Pin* pin)
+{
+    m_polledPins.erase(std::remove(m_polledPins.begin(), m_polledPins.end(), pin), m_polledPins.end());
+    m_dirty = true;
+}
+
+bool LazyNode::polledChanged() const
+{
+    LAZY_COUNT(stats.pinReads, m_polled.size());
+    for (const Polled& p : m_polled)
+    {
+        PinState_E_t state = p.pin->get_state();
+        if (state != p.state)
+        {
+            return true;
+        }
+        if (state != kInput && p.pin->get_value() != p.value)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LazyNode::resolve()
+{
+    ElectricalNode::evaluate();
+    m_value = ElectricalNode::get_value();
+    m_valid = true;
+    m_dirty = false;
+
+    // Snapshot after resolving, input pins now hold the node value
+    m_polled.clear();
+    for (Pin* pin : m_polledPins)
+    {
+        m_polled.push_back(Polled{pin, pin->get_state(), pin->get_value()});
+    }
+}
+
+void LazyNode::evaluate()
+{
+    if (m_dirty || polledChanged())
+    {
+        resolve();
+        LAZY_COUNT(stats.resolves, 1);
+        return;
+    }
+
+    LAZY_COUNT(stats.skips, 1);
+
+    #ifdef LAZY_VERIFY
+    // Shadow check, get_value() keeps returning the cached value
+    ElectricalNode::evaluate();
+    if (ElectricalNode::get_value() != m_value)
+    {
+        stats.mismatches++;
+    }
+    #endif
+}
+
+void LazyNode::report()
+{
+    printf(" = = = Lazy Resolution = = = \n");
+    printf("Nodes  | Resolves: %llu |\t Skips: %llu |\t Pin reads: %llu |\t",
+           (unsigned long long)stats.resolves, (unsigned long long)stats.skips,
+           (unsigned long long)stats.pinReads);
+    #ifdef LAZY_VERIFY
+    printf(" Mismatches: %llu\n", (unsigned long long)stats.mismatches);
+    #else
+    printf(" Verify: off\n");
+    #endif
+
+    const LazyStats& g = LazyPinGroup::stats;
+    printf("Groups | Resolves: %llu |\t Skips: %llu |\t Pin reads: %llu |\t",
+           (unsigned long long)g.resolves, (unsigned long long)g.skips,
+           (unsigned long long)g.pinReads);
+    #ifdef LAZY_VERIFY
+    printf(" Mismatches: %llu\n", (unsigned long long)g.mismatches);
+    #else
+    printf(" Verify: off\n");
+    #endif
+}
+
+// ==============================================
+// LazyDrivers
+
+void LazyDrivers::add(Pin* pin, LazyNode* node)
+{
+    // Never matches a real pin, the first update() marks the node dirty
+    m_pins.push_back(Watched{pin, node, 0xFF});
+    node->unpoll(pin);
+}
+
+void LazyDrivers::add(LazyPinGroup* group)
+{
+    group->m_tracked = true;
+    group->m_dirty = true;
+    m_groups.push_back(group);
+}
+
+void LazyDrivers::update()
+{
+    LAZY_COUNT(LazyNode::stats.pinReads, m_pins.size());
+    for (Watched& w : m_pins)
+    {
+        uint8_t code = pinCode(*w.pin);
+        if (code != w.last)
+        {
+            w.last = code;
+            w.node->invalidate();
+        }
+    }
+}
+
+void LazyDrivers::updateGroups()
+{
+    // A dirty group stays dirty until it is read, only clean ones compare
+    for (LazyPinGroup* group : m_groups)
+    {
+        if (!group->m_dirty && group->pinsChanged())
+        {
+            group->m_dirty = true;
+        }
+    }
+}
+
+// ==============================================
+// LazyPinGroup
+
+bool LazyPinGroup::pinsChanged() const
+{
+    if (m_snapshot.size() != (size_t)m_group.num_pins)
+    {
+        return true;
+    }
+    LAZY_COUNT(stats.pinReads, m_group.num_pins);
+    for (int i = 0; i < m_group.num_pins; i++)
+    {
+        if (m_snapshot[i] != pinCode(m_group.pins[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LazyPinGroup::snapshot()
+{
+    m_snapshot.resize(m_group.num_pins);
+    for (int i = 0; i < m_group.num_pins; i++)
+    {
+        m_snapshot[i] = pinCode(m_group.pins[i]);
+    }
+}
+
+void LazyPinGroup::resolve()
+{
+    m_value = getPinGroup(m_group);
+    m_valid = true;
+    m_dirty = false;
+    m_epoch = s_epoch;
+    snapshot();
+    LAZY_COUNT(stats.resolves, 1);
+}
+
+int LazyPinGroup::get()
+{
+    if (m_tracked)
+    {
+        if (m_dirty || !m_valid)
+        {
+            resolve();
+        }
+        else
+        {
+            LAZY_COUNT(stats.skips, 1);
+        }
+    }
+    else if (m_valid && m_epoch == s_epoch)
+    {
+        LAZY_COUNT(stats.skips, 1);
+    }
+    else if (!m_valid || pinsChanged())
+    {
+        resolve();
+    }
+    else
+    {
+        m_epoch = s_epoch;
+        LAZY_COUNT(stats.skips, 1);
+    }
+
+    #ifdef LAZY_VERIFY
+    // Shadow check of whichever path was taken
+    if (getPinGroup(m_group) != m_value)
+    {
+        stats.mismatches++;
+    }
+    #endif
+    return m_value;
+}
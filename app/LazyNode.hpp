@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Dirty-flag lazy resolution for nodes and pin groups
+
+    LazyNode is a drop-in ElectricalNode that remembers the pins it is
+    connected to and only resolves when it is dirty. The flag is set from
+    the driver side: LazyDrivers holds the output pins of the parts, reads
+    each one once per step after the parts have run, and invalidates the
+    node it sits on when its state or value changed. get_value() returns
+    the cached result.
+
+    Pin roles come from elaboration, see Elaborator::trackDrivers(). A pin
+    nobody described is polled by its node after every resolve, so a node
+    wired to an undescribed part stays correct, only slower.
+
+    LazyPinGroup wraps a pinGroup_t the same way for getPinGroup(). A group
+    added to LazyDrivers is compared against its last read once per step by
+    updateGroups(), only while it is clean, so a clean group read costs a
+    flag test and an unread dirty one costs nothing. A group nobody tracks
+    (Sap2System) compares its pins on the first read of each step.
+
+    LAZY_STATS counts resolves, skips and pin reads. LAZY_VERIFY runs the
+    same cached paths and shadow-checks every skipped resolve against a
+    full one, mismatches are counted in LazyStats.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <sim.hpp>
+
+// #define LAZY_STATS
+// #define LAZY_VERIFY
+
+#ifdef LAZY_VERIFY
+#ifndef LAZY_STATS
+#define LAZY_STATS
+#endif
+#endif
+
+struct LazyStats
+{
+    uint64_t resolves {0};
+    uint64_t skips {0};
+    uint64_t pinReads {0};
+    uint64_t mismatches {0};
+};
+
+class LazyNode : public DCSim::ElectricalNode
+{
+public:
+    void connect(DCSim::Pin* pin);
+
+    // Resolve only when dirty or a polled pin changed since the last resolve
+    void evaluate();
+
+    DCSim::PinValue_E_t get_value()
+    {
+        return m_valid ? m_value : DCSim::ElectricalNode::get_value();
+    }
+
+    // Force the next evaluate() to resolve
+    void invalidate() { m_dirty = true; }
+
+    // pin cannot change the node unseen: an input, a rail, or watched by LazyDrivers
+    void unpoll(DCSim::Pin* pin);
+
+    // Every pin connected so far, read by elaboration
+    const std::vector<DCSim::Pin*>& pins() const { return m_pins; }
+
+    static LazyStats stats;
+    static void report();
+
+private:
+    struct Polled
+    {
+        DCSim::Pin* pin;
+        DCSim::PinState_E_t state;
+        DCSim::PinValue_E_t value;
+    };
+
+    bool polledChanged() const;
+    void resolve();
+
+    std::vector<DCSim::Pin*> m_pins;
+    std::vector<DCSim::Pin*> m_polledPins;
+    std::vector<Polled> m_polled;
+    DCSim::PinValue_E_t m_value {DCSim::kLogicLow};
+    bool m_dirty {true};
+    bool m_valid {false};
+};
+
+class LazyPinGroup;
+
+// Part output pins, each marks the node it drives dirty when it changes
+class LazyDrivers
+{
+public:
+    void add(DCSim::Pin* pin, LazyNode* node);
+
+    // Group of part outputs read as a whole
+    void add(LazyPinGroup* group);
+
+    // Once per step, after the parts and the clock have set their pins and
+    // before the nodes evaluate
+    void update();
+
+    // Once per step, after the parts and buses and before the groups are read
+    void updateGroups();
+
+    size_t size() const { return m_pins.size(); }
+
+private:
+    struct Watched
+    {
+        DCSim::Pin* pin;
+        LazyNode* node;
+        uint8_t last;       // state << 4 | value
+    };
+
+    std::vector<Watched> m_pins;
+    std::vector<LazyPinGroup*> m_groups;
+};
+
+class LazyPinGroup
+{
+public:
+    explicit LazyPinGroup(DCSim::pinGroup_t& group) : m_group(group) {}
+
+    int get();
+
+    // Called once per simulation step
+    static void advanceEpoch() { s_epoch++; }
+
+    static LazyStats stats;
+
+private:
+    friend class LazyDrivers;
+
+    bool pinsChanged() const;
+    void snapshot();
+    void resolve();
+
+    DCSim::pinGroup_t& m_group;
+    std::vector<uint8_t> m_snapshot;    // state << 4 | value per pin
+    int m_value {0};
+    uint64_t m_epoch {UINT64_MAX};
+    bool m_valid {false};
+    bool m_tracked {false};             // marked by LazyDrivers, no epoch compare
+    bool m_dirty {true};
+
+    static uint64_t s_epoch;
+};
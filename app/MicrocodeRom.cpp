@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <MicrocodeRom.hpp>
+
+const char* const kCtrlNames[MICROCODE_BITS] = {
+    "PC_Out", "PC_Count", "IR_Load", "StoreMem", "Subtract", "JumpZero", "JumpCarry", "HALT",
+    "MAR_Load", "B_Load", "Status_Load", "Out_Load", "IR_Out", "A_Out", "Shift_Out", "A_Load",
+    "Mem_Out", "Alu_Out", "PC_Load", "Mem_Load"
+};
+
+// T1 - T3, shared by every opcode
+static const uint32_t kFetch[3] = {
+    kCtrlPcOut | kCtrlMarLoad,      // MAR <- PC
+    kCtrlPcCount,                   // PC  <- PC + 1
+    kCtrlMemOut | kCtrlIrLoad       // IR  <- MEM[MAR]
+};
+
+// Later rows override earlier ones, conditional jumps list the not taken
+// case first
+const MicroOp_t kSap2Microcode[] = {
+    // op       cond            T4                                  T5
+    {kOpNOP,    kCondAlways,    0,                                  0},
+    {kOpLDI,    kCondAlways,    0,                                  kCtrlIrOut | kCtrlALoad},
+    {kOpLDA,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          kCtrlMemOut | kCtrlALoad},
+    {kOpLDB,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          kCtrlMemOut | kCtrlBLoad},
+    {kOpJMP,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          kCtrlMemOut | kCtrlPcLoad},
+    {kOpJPZ,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          0},
+    {kOpJPZ,    kCondZero,      kCtrlIrOut | kCtrlMarLoad | kCtrlJumpZero,
+                                                                    kCtrlMemOut | kCtrlPcLoad | kCtrlJumpZero},
+    {kOpJPC,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          0},
+    {kOpJPC,    kCondCarry,     kCtrlIrOut | kCtrlMarLoad | kCtrlJumpCarry,
+                                                                    kCtrlMemOut | kCtrlPcLoad | kCtrlJumpCarry},
+    {kOpSTR,    kCondAlways,    kCtrlIrOut | kCtrlMarLoad,          kCtrlAOut | kCtrlMemLoad | kCtrlStoreMem},
+    {kOpLDM,    kCondAlways,    kCtrlAOut | kCtrlMarLoad,           kCtrlMemOut | kCtrlALoad},
+    {kOpMOV,    kCondAlways,    0,                                  kCtrlAOut | kCtrlBLoad},
+    {kOpOUT,    kCondAlways,    0,                                  kCtrlAOut | kCtrlOutLoad},
+    {kOpSTM,    kCondAlways,    kCtrlAOut | kCtrlMarLoad,           kCtrlAluOut | kCtrlMemLoad | kCtrlStoreMem},
+    {kOpADD,    kCondAlways,    kCtrlStatusLoad,                    kCtrlAluOut | kCtrlALoad},
+    {kOpSUB,    kCondAlways,    kCtrlStatusLoad | kCtrlSubtract,    kCtrlAluOut | kCtrlALoad | kCtrlSubtract},
+    {kOpSFT,    kCondAlways,    0,                                  kCtrlShiftOut | kCtrlALoad},
+    {kOpHLT,    kCondAlways,    kCtrlHalt,                          kCtrlHalt}
+};
+
+const size_t kSap2MicrocodeSize = sizeof(kSap2Microcode) / sizeof(kSap2Microcode[0]);
+
+MicrocodeRom::MicrocodeRom()
+{
+    generate(kSap2Microcode, kSap2MicrocodeSize);
+}
+
+void MicrocodeRom::generate(const MicroOp_t* table, size_t size)
+{
+    memset(m_words, 0, sizeof(m_words));
+    memset(m_images, 0, sizeof(m_images));
+
+    for (int flags = 0; flags < 4; flags++)
+    {
+        bool zero = flags & 1;
+        bool carry = flags & 2;
+
+        for (int op = 0; op < 16; op++)
+        {
+            for (int t = 0; t < 3; t++)
+            {
+                m_words[address(op, t, zero, carry)] = kFetch[t];
+            }
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            const MicroOp_t& row = table[i];
+            if ((row.cond == kCondZero && !zero) || (row.cond == kCondCarry && !carry))
+            {
+                continue;
+            }
+            m_words[address(row.opcode, 3, zero, carry)] = row.t4;
+            m_words[address(row.opcode, 4, zero, carry)] = row.t5;
+        }
+    }
+
+    // Split into byte lanes, A11 and A12 are grounded so only the low 2K is used
+    for (int addr = 0; addr < MICROCODE_WORDS; addr++)
+    {
+        for (int lane = 0; lane < MICROCODE_LANES; lane++)
+        {
+            m_images[lane][addr] = (uint8_t)(m_words[addr] >> (8 * lane));
+        }
+    }
+}
+
+bool MicrocodeRom::save(const char* prefix) const
+{
+    char path[256];
+    for (int lane = 0; lane < MICROCODE_LANES; lane++)
+    {
+        snprintf(path, sizeof(path), "%s_%d.bin", prefix, lane);
+        FILE* file = fopen(path, "wb");
+        if (!file)
+        {
+            printf("MicrocodeRom: cannot write %s\n", path);
+            return false;
+        }
+        fwrite(m_images[lane], 1, MICROCODE_ROM_SIZE, file);
+        fclose(file);
+        printf("Microcode lane %d -> %s\n", lane, path);
+    }
+    return true;
+}
+
+void MicrocodeRom::print(uint8_t opcode) const
+{
+    printf("%s\n", kSap2Mnemonics[opcode & 0x0F]);
+    for (int flags = 0; flags < 4; flags++)
+    {
+        for (int t = 0; t < SAP2_T_STATES; t++)
+        {
+            uint32_t w = lookup(opcode, t, flags & 1, flags & 2);
+            printf("  Z%d C%d T%d | 0x%05x |", flags & 1, (flags >> 1) & 1, t + 1, w);
+            for (int bit = 0; bit < MICROCODE_BITS; bit++)
+            {
+                if (w & (1u << bit))
+                {
+                    printf(" %s", kCtrlNames[bit]);
+                }
+            }
+            printf("\n");
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Microcoded control unit ROM
+
+    Instead of decoding the op code with gates, the control word for every
+    {opcode, T-state, flags} is stored in ROM and each T-state is a single
+    lookup. The 20 bit word is split over three AT28C64 byte lanes, every
+    lane sees the same address:
+
+        A0  - A3    opcode          IR[7:4]
+        A4  - A8    T-state         RC1 - RC5, one hot
+        A9          zero flag
+        A10         carry flag
+        A11 - A12   grounded
+
+    Addresses that are not a single hot T-state hold 0, so a ring counter
+    glitch never asserts a control line.
+
+    generate() builds the ROM from an instruction table: the fetch steps
+    T1 - T3 are shared, each table row gives T4 and T5 for one opcode and
+    flag condition. Changing the ISA means editing the table and
+    regenerating, not rewiring gates.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <Sap2Cpu.hpp>
+
+#define MICROCODE_BITS          20
+#define MICROCODE_LANES         3
+#define MICROCODE_ADDR_BITS     11
+#define MICROCODE_WORDS         (1 << MICROCODE_ADDR_BITS)
+
+// AT28C64, 8K x 8
+#define MICROCODE_ROM_SIZE      8192
+
+// Control word bits, same order as the 20 bit control bus in app.cpp
+enum Ctrl_E_t : uint32_t
+{
+    // Fixed, fetch and instruction modify
+    kCtrlPcOut      = 1u << 0,
+    kCtrlPcCount    = 1u << 1,
+    kCtrlIrLoad     = 1u << 2,
+    kCtrlStoreMem   = 1u << 3,
+    kCtrlSubtract   = 1u << 4,
+    kCtrlJumpZero   = 1u << 5,
+    kCtrlJumpCarry  = 1u << 6,
+    kCtrlHalt       = 1u << 7,
+
+    // Sequenced, execute
+    kCtrlMarLoad    = 1u << 8,
+    kCtrlBLoad      = 1u << 9,
+    kCtrlStatusLoad = 1u << 10,
+    kCtrlOutLoad    = 1u << 11,
+    kCtrlIrOut      = 1u << 12,
+    kCtrlAOut       = 1u << 13,
+    kCtrlShiftOut   = 1u << 14,
+    kCtrlALoad      = 1u << 15,
+    kCtrlMemOut     = 1u << 16,
+    kCtrlAluOut     = 1u << 17,
+    kCtrlPcLoad     = 1u << 18,
+    kCtrlMemLoad    = 1u << 19
+};
+
+// Indexed by control bit
+extern const char* const kCtrlNames[MICROCODE_BITS];
+
+inline int ctrlBit(uint32_t ctrl)
+{
+    return __builtin_ctz(ctrl);
+}
+
+enum MicroCond_E_t
+{
+    kCondAlways = 0,
+    kCondZero,
+    kCondCarry
+};
+
+// One row of the instruction table
+struct MicroOp_t
+{
+    uint8_t opcode;
+    MicroCond_E_t cond;     // T4/T5 only run when the flag is set
+    uint32_t t4;
+    uint32_t t5;
+};
+
+// 8SAP2 instruction set, mirrors Sap2Cpu::step()
+extern const MicroOp_t kSap2Microcode[];
+extern const size_t kSap2MicrocodeSize;
+
+class MicrocodeRom
+{
+public:
+    MicrocodeRom();
+
+    // Rebuild every word from an instruction table
+    void generate(const MicroOp_t* table, size_t size);
+
+    static uint16_t address(uint8_t opcode, int t_state, bool zero, bool carry)
+    {
+        return (uint16_t)((opcode & 0x0F) | (1u << (4 + t_state)) | (zero << 9) | (carry << 10));
+    }
+
+    // One lookup per T-state, t_state 0 - 4 for T1 - T5
+    uint32_t lookup(uint8_t opcode, int t_state, bool zero, bool carry) const
+    {
+        return m_words[address(opcode, t_state, zero, carry)];
+    }
+
+    uint32_t word(uint16_t addr) const { return m_words[addr & (MICROCODE_WORDS - 1)]; }
+
+    // Byte lane image for AT28C64::loadProgram() or an EEPROM programmer
+    uint8_t* image(int lane) { return m_images[lane]; }
+
+    // Writes <prefix>_<lane>.bin for each lane
+    bool save(const char* prefix) const;
+
+    void print(uint8_t opcode) const;
+
+private:
+    uint32_t m_words[MICROCODE_WORDS];
+    uint8_t m_images[MICROCODE_LANES][MICROCODE_ROM_SIZE];
+};
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <chrono>
+#include <cstring>
+#include <OutputStream.hpp>
+
+// Binary record: cycle, port, value
+#define OUTPUT_RECORD_BYTES 10
+
+// Longest the consumer sleeps on an empty ring before looking again
+#define OUTPUT_IDLE_MS      20
+
+OutputStream::OutputStream(size_t capacity, size_t batch)
+    : m_ring(capacity), m_batch(batch)
+{
+}
+
+OutputStream::~OutputStream()
+{
+    stop();
+    drain();
+}
+
+void OutputStream::toFile(FILE* file, bool binary)
+{
+    m_file = file;
+    m_binary = binary;
+}
+
+void OutputStream::toCallback(BatchFn fn)
+{
+    m_callback = fn;
+}
+
+// ==============================================
+// Producer
+
+void OutputStream::push(const OutputRecord& record)
+{
+    bool woken = false;
+    while (!m_ring.push(record))
+    {
+        if (m_running.load(std::memory_order_acquire))
+        {
+            // Full, make sure the consumer is up and wait for it
+            if (!woken)
+            {
+                wake();
+                woken = true;
+            }
+            std::this_thread::yield();
+        }
+        else
+        {
+            // No consumer thread, the producer is the only reader
+            drain();
+        }
+    }
+    m_produced++;
+
+    // One wake per batch, the consumer sleeps until there is work
+    if (++m_unsignalled >= m_batch.size())
+    {
+        m_unsignalled = 0;
+        if (m_running.load(std::memory_order_relaxed))
+        {
+            wake();
+        }
+    }
+}
+
+void OutputStream::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake = true;
+    }
+    m_cv.notify_one();
+}
+
+// ==============================================
+// Consumer
+
+size_t OutputStream::drain()
+{
+    size_t total = 0;
+    size_t n;
+    while ((n = m_ring.popBatch(m_batch.data(), m_batch.size())) > 0)
+    {
+        deliver(m_batch.data(), n);
+        total += n;
+    }
+    return total;
+}
+
+void OutputStream::deliver(const OutputRecord* records, size_t count)
+{
+    if (m_file)
+    {
+        if (m_binary)
+        {
+            // Field by field, the struct's padding is never written
+            m_packed.resize(count * OUTPUT_RECORD_BYTES);
+            uint8_t* p = m_packed.data();
+            for (size_t i = 0; i < count; i++)
+            {
+                memcpy(p, &records[i].cycle, sizeof(uint64_t));
+                p[8] = records[i].port;
+                p[9] = records[i].value;
+                p += OUTPUT_RECORD_BYTES;
+            }
+            fwrite(m_packed.data(), 1, m_packed.size(), m_file);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                fprintf(m_file, "%llu,%u,%u\n", (unsigned long long)records[i].cycle,
+                        records[i].port, records[i].value);
+            }
+        }
+    }
+
+    if (m_callback)
+    {
+        m_callback(records, count);
+    }
+
+    m_consumed += count;
+    m_batches++;
+}
+
+void OutputStream::start()
+{
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+
+    m_thread = std::thread([this]
+    {
+        while (m_running.load(std::memory_order_acquire))
+        {
+            if (drain() == 0)
+            {
+                // Empty, sleep until a batch is pushed or stop(). The timeout
+                // picks up the tail of a batch that never fills
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait_for(lock, std::chrono::milliseconds(OUTPUT_IDLE_MS),
+                              [this]{ return m_wake || !m_running.load(std::memory_order_acquire); });
+                m_wake = false;
+            }
+        }
+    });
+}
+
+void OutputStream::stop()
+{
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+    wake();
+    m_thread.join();
+    drain();
+
+    if (m_file)
+    {
+        fflush(m_file);
+    }
+}
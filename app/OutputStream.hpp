@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Batched output streaming
+
+    Peripherals push OutputRecords into an SPSC ring from the simulation
+    thread. A consumer drains the ring in batches into a file and/or a
+    callback, either on its own thread (start/stop) or inline whenever the
+    ring fills up when no thread is running. The consumer thread sleeps
+    while the ring is empty, the producer wakes it once per batch pushed.
+
+    Binary files hold 10 byte records in host byte order:
+        uint64    cycle
+        uint8     port
+        uint8     value
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SpscRing.hpp>
+
+struct OutputRecord
+{
+    uint64_t cycle;
+    uint8_t port;
+    uint8_t value;
+};
+
+class OutputStream
+{
+public:
+    typedef std::function<void(const OutputRecord* records, size_t count)> BatchFn;
+
+    explicit OutputStream(size_t capacity = 1 << 16, size_t batch = 1024);
+    ~OutputStream();
+
+    // Sinks, either or both. Detach the file with toFile(nullptr) before closing it
+    void toFile(FILE* file, bool binary = false);
+    void toCallback(BatchFn fn);
+
+    // Producer side, never drops: drains inline or waits on the consumer when full
+    void push(const OutputRecord& record);
+
+    // Consumer side
+    size_t drain();
+    void start();
+    void stop();
+
+    uint64_t produced() const { return m_produced; }
+    uint64_t consumed() const { return m_consumed; }
+    uint64_t batches() const { return m_batches; }
+
+private:
+    void deliver(const OutputRecord* records, size_t count);
+    void wake();
+
+    SpscRing<OutputRecord> m_ring;
+    std::vector<OutputRecord> m_batch;
+    std::vector<uint8_t> m_packed;      // binary file records
+
+    FILE* m_file {nullptr};
+    bool m_binary {false};
+    BatchFn m_callback;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running {false};
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_wake {false};                // under m_mutex
+    size_t m_unsignalled {0};           // pushed since the last wake()
+
+    uint64_t m_produced {0};
+    uint64_t m_consumed {0};
+    uint64_t m_batches {0};
+};
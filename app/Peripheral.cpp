@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <Peripheral.hpp>
+
+// ==============================================
+// Peripheral map
+
+PeripheralMap::PeripheralMap()
+{
+    for (Slot& slot : m_table)
+    {
+        slot.peripheral = nullptr;
+        slot.base = 0;
+    }
+}
+
+void PeripheralMap::attach(uint8_t base, uint16_t size, Peripheral* peripheral)
+{
+    for (unsigned addr = base; addr < (unsigned)base + size && addr < PERIPHERAL_MAP_SIZE; addr++)
+    {
+        m_table[addr].peripheral = peripheral;
+        m_table[addr].base = base;
+    }
+}
+
+bool PeripheralMap::write(uint8_t addr, uint8_t value, uint64_t cycle)
+{
+    const Slot& slot = m_table[addr];
+    if (!slot.peripheral)
+    {
+        return false;
+    }
+    slot.peripheral->write(addr - slot.base, value, cycle);
+    return true;
+}
+
+bool PeripheralMap::read(uint8_t addr, uint8_t& value)
+{
+    const Slot& slot = m_table[addr];
+    if (!slot.peripheral)
+    {
+        return false;
+    }
+    return slot.peripheral->read(addr - slot.base, value);
+}
+
+// ==============================================
+// Output register
+
+OutputRegister::OutputRegister(OutputStream& stream, uint8_t port)
+    : m_stream(stream), m_port(port)
+{
+}
+
+void OutputRegister::write(uint8_t offset, uint8_t value, uint64_t cycle)
+{
+    (void)offset;
+    m_value = value;
+    m_stream.push(OutputRecord{cycle, m_port, value});
+}
+
+bool OutputRegister::read(uint8_t offset, uint8_t& value)
+{
+    (void)offset;
+    value = m_value;
+    return true;
+}
+
+void OutputRegister::sampleBus(uint8_t bus_value, bool load, uint64_t cycle)
+{
+    if (load)
+    {
+        write(0, bus_value, cycle);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Memory-mapped and bus-attached peripherals
+
+    A Peripheral sees writes (and optionally reads) either from an address
+    range in a PeripheralMap, or from a bus it is attached to when its load
+    strobe is asserted. Offsets passed in are relative to the mapped base.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <OutputStream.hpp>
+
+// Address space covered by a PeripheralMap
+#define PERIPHERAL_MAP_SIZE 256
+
+class Peripheral
+{
+public:
+    virtual ~Peripheral() {}
+
+    virtual void write(uint8_t offset, uint8_t value, uint64_t cycle) = 0;
+
+    // Returns false when the peripheral does not drive the bus on reads
+    virtual bool read(uint8_t offset, uint8_t& value)
+    {
+        (void)offset;
+        (void)value;
+        return false;
+    }
+};
+
+class PeripheralMap
+{
+public:
+    PeripheralMap();
+
+    // Map [base, base + size) to a peripheral, later mappings win
+    void attach(uint8_t base, uint16_t size, Peripheral* peripheral);
+
+    bool claims(uint8_t addr) const { return m_table[addr].peripheral != nullptr; }
+
+    // Return true when a peripheral handled the access
+    bool write(uint8_t addr, uint8_t value, uint64_t cycle);
+    bool read(uint8_t addr, uint8_t& value);
+
+private:
+    struct Slot
+    {
+        Peripheral* peripheral;
+        uint8_t base;
+    };
+
+    Slot m_table[PERIPHERAL_MAP_SIZE];
+};
+
+// ==========================
+// Output register
+
+class OutputRegister : public Peripheral
+{
+public:
+    OutputRegister(OutputStream& stream, uint8_t port = 0);
+
+    void write(uint8_t offset, uint8_t value, uint64_t cycle) override;
+    bool read(uint8_t offset, uint8_t& value) override;
+
+    // Bus attachment, latches the bus value while load is asserted
+    void sampleBus(uint8_t bus_value, bool load, uint64_t cycle);
+
+    uint8_t get_value() const { return m_value; }
+
+private:
+    OutputStream& m_stream;
+    uint8_t m_port;
+    uint8_t m_value {0};
+};
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstring>
+#include <Sap2BlockCache.hpp>
+
+const Sap2BlockCache::Handler Sap2BlockCache::kHandlers[16] = {
+    &Sap2BlockCache::opNop,
+    &Sap2BlockCache::opLdi,
+    &Sap2BlockCache::opLda,
+    &Sap2BlockCache::opLdb,
+    &Sap2BlockCache::opJmp,
+    &Sap2BlockCache::opJpz,
+    &Sap2BlockCache::opJpc,
+    &Sap2BlockCache::opStr,
+    &Sap2BlockCache::opLdm,
+    &Sap2BlockCache::opMov,
+    &Sap2BlockCache::opOut,
+    &Sap2BlockCache::opStm,
+    &Sap2BlockCache::opAdd,
+    &Sap2BlockCache::opSub,
+    &Sap2BlockCache::opSft,
+    &Sap2BlockCache::opHlt
+};
+
+Sap2BlockCache::Sap2BlockCache(Sap2Cpu& cpu) : m_cpu(cpu)
+{
+    memset(m_codeRefs, 0, sizeof(m_codeRefs));
+    m_cpu.onWrite = &Sap2BlockCache::onWrite;
+    m_cpu.onWriteCtx = this;
+}
+
+Sap2BlockCache::~Sap2BlockCache()
+{
+    if (m_cpu.onWriteCtx == this)
+    {
+        m_cpu.onWrite = nullptr;
+        m_cpu.onWriteCtx = nullptr;
+    }
+}
+
+// ==============================================
+// Translation
+
+Sap2BlockCache::Block& Sap2BlockCache::translate(uint8_t pc)
+{
+    Block& b = m_blocks[pc];
+    b.ops.clear();
+    b.start = pc;
+
+    const uint8_t* mem = m_cpu.mem;
+    unsigned addr = pc;
+    uint32_t done = 0;
+
+    while (done < SAP2_MAX_BLOCK_INSTR && addr < SAP2_MEM_SIZE)
+    {
+        uint8_t ir = mem[addr];
+        uint8_t opcode = ir >> 4;
+
+        Op op;
+        op.fn = kHandlers[opcode];
+        op.operand = ir & 0x0F;
+        op.pc = (uint8_t)addr;
+        op.ir = ir;
+        addr++;
+        done++;
+
+        // Fuse a load with the ALU op that follows it
+        if ((opcode == kOpLDA || opcode == kOpLDB) && addr < SAP2_MEM_SIZE && done < SAP2_MAX_BLOCK_INSTR)
+        {
+            uint8_t ir2 = mem[addr];
+            uint8_t opcode2 = ir2 >> 4;
+            if (opcode2 == kOpADD || opcode2 == kOpSUB)
+            {
+                if (opcode == kOpLDA)
+                {
+                    op.fn = (opcode2 == kOpADD) ? &Sap2BlockCache::opLdaAdd : &Sap2BlockCache::opLdaSub;
+                }
+                else
+                {
+                    op.fn = (opcode2 == kOpADD) ? &Sap2BlockCache::opLdbAdd : &Sap2BlockCache::opLdbSub;
+                }
+                op.pc = (uint8_t)addr;
+                op.ir = ir2;
+                addr++;
+                done++;
+                fusedPairs++;
+            }
+        }
+
+        op.next = (uint8_t)addr;
+        op.done = done;
+        b.ops.push_back(op);
+
+        if (opcode == kOpJMP || opcode == kOpJPZ || opcode == kOpJPC || opcode == kOpHLT)
+        {
+            break;
+        }
+    }
+
+    b.end = (uint8_t)addr;
+    b.length = (uint16_t)(addr - pc);
+    b.valid = true;
+
+    for (unsigned a = pc; a < addr; a++)
+    {
+        m_codeRefs[a]++;
+    }
+    translations++;
+    return b;
+}
+
+void Sap2BlockCache::onWrite(void* ctx, uint8_t addr)
+{
+    ((Sap2BlockCache*)ctx)->invalidate(addr);
+}
+
+void Sap2BlockCache::invalidate(uint8_t addr)
+{
+    if (m_codeRefs[addr] == 0)
+    {
+        return;
+    }
+
+    for (Block& b : m_blocks)
+    {
+        if (!b.valid || addr < b.start || addr >= b.start + b.length)
+        {
+            continue;
+        }
+
+        // Ops stay allocated so an executing block can finish its handler
+        b.valid = false;
+        for (unsigned a = b.start; a < (unsigned)b.start + b.length; a++)
+        {
+            m_codeRefs[a]--;
+        }
+        invalidations++;
+
+        if (&b == m_current)
+        {
+            m_abort = true;
+        }
+    }
+}
+
+void Sap2BlockCache::flush()
+{
+    for (Block& b : m_blocks)
+    {
+        b.valid = false;
+        b.ops.clear();
+    }
+    memset(m_codeRefs, 0, sizeof(m_codeRefs));
+}
+
+// ==============================================
+// Execution
+
+uint64_t Sap2BlockCache::run(uint64_t max_instructions)
+{
+    Sap2State_t& s = m_cpu.state;
+    uint64_t start = s.instructions;
+
+    while (!s.halted)
+    {
+        uint64_t left = max_instructions - (s.instructions - start);
+        if (left == 0)
+        {
+            break;
+        }
+
+        Block* b = &m_blocks[s.pc];
+        if (!b->valid)
+        {
+            b = &translate(s.pc);
+        }
+
+        // Not enough budget for the whole block, finish on the interpreter
+        if (b->ops.back().done > left)
+        {
+            m_cpu.step();
+            continue;
+        }
+
+        m_current = b;
+        m_abort = false;
+
+        const Op* op = b->ops.data();
+        const Op* end = op + b->ops.size();
+        bool fallthrough = true;
+        while (op != end)
+        {
+            const Op* cur = op++;
+            if (!cur->fn(*this, *cur))
+            {
+                fallthrough = false;
+                break;
+            }
+        }
+
+        const Op& last = *(op - 1);
+        if (fallthrough)
+        {
+            s.pc = b->end;
+        }
+        s.instructions += last.done;
+        s.cycles += (uint64_t)last.done * SAP2_T_STATES;
+        blocksExecuted++;
+        m_current = nullptr;
+    }
+
+    return s.instructions - start;
+}
+
+// ==============================================
+// Handlers, each leaves IR and MAR as the T-state sequence would
+
+#define CPU_STATE (c.m_cpu.state)
+
+bool Sap2BlockCache::opNop(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    return true;
+}
+
+bool Sap2BlockCache::opLdi(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    CPU_STATE.a = op.operand;
+    return true;
+}
+
+bool Sap2BlockCache::opLda(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    CPU_STATE.a = c.m_cpu.read(op.operand);
+    return true;
+}
+
+bool Sap2BlockCache::opLdb(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    CPU_STATE.b = c.m_cpu.read(op.operand);
+    return true;
+}
+
+bool Sap2BlockCache::opJmp(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    CPU_STATE.pc = c.m_cpu.read(op.operand);
+    return false;
+}
+
+bool Sap2BlockCache::opJpz(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    CPU_STATE.pc = CPU_STATE.zero ? c.m_cpu.read(op.operand) : op.next;
+    return false;
+}
+
+bool Sap2BlockCache::opJpc(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    CPU_STATE.pc = CPU_STATE.carry ? c.m_cpu.read(op.operand) : op.next;
+    return false;
+}
+
+bool Sap2BlockCache::opStr(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.operand;
+    c.m_cpu.write(op.operand, CPU_STATE.a, CPU_STATE.cycles + (uint64_t)op.done * SAP2_T_STATES);
+    if (c.m_abort)
+    {
+        CPU_STATE.pc = op.next;
+        return false;
+    }
+    return true;
+}
+
+bool Sap2BlockCache::opLdm(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = CPU_STATE.a;
+    CPU_STATE.a = c.m_cpu.read(CPU_STATE.mar);
+    return true;
+}
+
+bool Sap2BlockCache::opMov(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    CPU_STATE.b = CPU_STATE.a;
+    return true;
+}
+
+bool Sap2BlockCache::opOut(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    c.m_cpu.output(CPU_STATE.a, CPU_STATE.cycles + (uint64_t)op.done * SAP2_T_STATES);
+    return true;
+}
+
+bool Sap2BlockCache::opStm(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = CPU_STATE.a;
+    Sap2State_t alu = CPU_STATE;
+    sap2Add(alu);
+    c.m_cpu.write(CPU_STATE.mar, alu.a, CPU_STATE.cycles + (uint64_t)op.done * SAP2_T_STATES);
+    if (c.m_abort)
+    {
+        CPU_STATE.pc = op.next;
+        return false;
+    }
+    return true;
+}
+
+bool Sap2BlockCache::opAdd(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Add(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opSub(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Sub(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opSft(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Shift(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opHlt(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    CPU_STATE.halted = true;
+    CPU_STATE.pc = op.next;
+    return false;
+}
+
+bool Sap2BlockCache::opLdaAdd(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.a = c.m_cpu.read(op.operand);
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Add(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opLdaSub(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.a = c.m_cpu.read(op.operand);
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Sub(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opLdbAdd(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.b = c.m_cpu.read(op.operand);
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Add(CPU_STATE);
+    return true;
+}
+
+bool Sap2BlockCache::opLdbSub(Sap2BlockCache& c, const Op& op)
+{
+    CPU_STATE.b = c.m_cpu.read(op.operand);
+    CPU_STATE.ir = op.ir;
+    CPU_STATE.mar = op.pc;
+    sap2Sub(CPU_STATE);
+    return true;
+}
+
+#undef CPU_STATE
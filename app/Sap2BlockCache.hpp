@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Basic-block translation cache for Sap2Cpu
+
+    Straight-line runs of instructions are decoded once into a chain of
+    pre-decoded handlers (call threading) and cached by start address. A
+    block ends after a jump or HLT. Common pairs are fused into one handler
+    (LDA/LDB followed by ADD/SUB). A memory write that lands inside a cached
+    block drops it, and if that block is the one executing it exits after
+    the store so the rewritten code is fetched fresh.
+
+    Architectural state (A, B, PC, IR, MAR, flags) and cycle counts match
+    Sap2Cpu::step() after every block.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Sap2Cpu.hpp>
+
+// Longest straight-line run translated into one block
+#define SAP2_MAX_BLOCK_INSTR 64
+
+class Sap2BlockCache
+{
+public:
+    explicit Sap2BlockCache(Sap2Cpu& cpu);
+    ~Sap2BlockCache();
+
+    uint64_t run(uint64_t max_instructions);
+
+    // Drop every block containing addr
+    void invalidate(uint8_t addr);
+    void flush();
+
+    uint64_t translations {0};
+    uint64_t invalidations {0};
+    uint64_t blocksExecuted {0};
+    uint64_t fusedPairs {0};
+
+private:
+    struct Op;
+    typedef bool (*Handler)(Sap2BlockCache& cache, const Op& op);
+
+    struct Op
+    {
+        Handler fn;
+        uint8_t operand;
+        uint8_t pc;         // fetch address of the (last) instruction
+        uint8_t ir;         // instruction byte left in IR
+        uint8_t next;       // PC after this op
+        uint32_t done;      // instructions retired up to and including this op
+    };
+
+    struct Block
+    {
+        std::vector<Op> ops;
+        uint8_t start {0};
+        uint8_t end {0};
+        uint16_t length {0};    // bytes covered
+        bool valid {false};
+    };
+
+    Block& translate(uint8_t pc);
+    static void onWrite(void* ctx, uint8_t addr);
+
+    // Handlers
+    static bool opNop(Sap2BlockCache& c, const Op& op);
+    static bool opLdi(Sap2BlockCache& c, const Op& op);
+    static bool opLda(Sap2BlockCache& c, const Op& op);
+    static bool opLdb(Sap2BlockCache& c, const Op& op);
+    static bool opJmp(Sap2BlockCache& c, const Op& op);
+    static bool opJpz(Sap2BlockCache& c, const Op& op);
+    static bool opJpc(Sap2BlockCache& c, const Op& op);
+    static bool opStr(Sap2BlockCache& c, const Op& op);
+    static bool opLdm(Sap2BlockCache& c, const Op& op);
+    static bool opMov(Sap2BlockCache& c, const Op& op);
+    static bool opOut(Sap2BlockCache& c, const Op& op);
+    static bool opStm(Sap2BlockCache& c, const Op& op);
+    static bool opAdd(Sap2BlockCache& c, const Op& op);
+    static bool opSub(Sap2BlockCache& c, const Op& op);
+    static bool opSft(Sap2BlockCache& c, const Op& op);
+    static bool opHlt(Sap2BlockCache& c, const Op& op);
+
+    // Superinstructions
+    static bool opLdaAdd(Sap2BlockCache& c, const Op& op);
+    static bool opLdaSub(Sap2BlockCache& c, const Op& op);
+    static bool opLdbAdd(Sap2BlockCache& c, const Op& op);
+    static bool opLdbSub(Sap2BlockCache& c, const Op& op);
+
+    static const Handler kHandlers[16];
+
+    Sap2Cpu& m_cpu;
+    Block m_blocks[SAP2_MEM_SIZE];
+    uint8_t m_codeRefs[SAP2_MEM_SIZE];  // blocks covering each address
+    Block* m_current {nullptr};
+    bool m_abort {false};
+};
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <Sap2Core.hpp>
+#include <Elaborator.hpp>
+
+#ifdef MICROCODE_CONTROL
+MicrocodeRom Sap2Core::microcode;
+#endif
+
+Sap2Core::Sap2Core()
+    : rc(5),
+      IRDecoderL_Q(IRDecoderL.Q_pins),
+      IRDecoderH_Q(IRDecoderH.Q_pins)
+    #ifdef MICROCODE_CONTROL
+      , UCode_Q{LazyPinGroup(ucode[0].io_pins), LazyPinGroup(ucode[1].io_pins), LazyPinGroup(ucode[2].io_pins)}
+    #endif
+{
+    nodes = {
+        &ground_node,
+        &source_node,
+        &ME_node,
+        &WE_node,
+        &MCE_node,
+        &LM_Node,
+        &CP_Node,
+        &LP_Node,
+        &PE_Node,
+        &LI_Node,
+        &IE_Node,
+        &CLK_Node,
+        &RC1_Node,
+        &RC2_Node,
+        &RC3_Node,
+        &RC4_Node,
+        &RC5_Node,
+        &OPCode[0],
+        &OPCode[1],
+        &OPCode[2],
+        &OPCode[3],
+        &NOPC4,
+        &NME_node,
+        &NWE_node
+    };
+
+    parts = {
+        &mar,
+        &ir,
+        &irb,
+        &pc,
+        &pcb,
+        &rc,
+        &Not_OE,
+        &Not_WE,
+        &Not_IRLe,
+        &IRDecoderL,
+        &IRDecoderH,
+        &Seq1Buffer,
+        &Seq2Buffer
+    };
+
+    buses = {
+        &mainBus,
+        &marBus,
+        &pcBus,
+        &irBus,
+        &controlLBus,
+        &controlHBus
+    };
+
+    #ifdef MICROCODE_CONTROL
+    for (int i = 0; i < MICROCODE_BITS; i++)
+    {
+        nodes.push_back(&Control[i]);
+    }
+    for (int lane = 0; lane < MICROCODE_LANES; lane++)
+    {
+        parts.push_back(&ucode[lane]);
+    }
+    #endif
+
+    m_hashNodes = nodes;
+}
+
+// ==============================================
+// Bus components attachments, memory is attached by the owner
+
+void Sap2Core::attach()
+{
+    // MAR drives the memory address
+    marBus.attach(mar.Q_pins);
+    
+    // main bus attach MAR
+    mainBus.attach(mar.D_pins);
+    
+    // PC (and PC buffer)
+    pcBus.attach(pc.Q_pins);
+    pcBus.attach(pcb.D_pins);
+    
+    // main bus attach PC subsys
+    mainBus.attach(pc.D_pins);
+    mainBus.attach(pcb.Q_pins);
+    
+    // IR (and IR Buffer)
+    irb.D_pins.num_pins = 4;
+    irb.Q_pins.num_pins = 4;
+    irBus.attach(ir.Q_pins);
+    irBus.attach(irb.D_pins);
+    
+    // main bus attach IR subsys
+    mainBus.attach(ir.D_pins);
+    mainBus.attach(irb.Q_pins);
+
+    // 16 bit control bus
+    controlLBus.attach(IRDecoderL.Q_pins);
+    controlHBus.attach(IRDecoderH.Q_pins);
+}
+
+void Sap2Core::wire()
+{
+    attach();
+
+    // ==========================
+    // GND and VCC Connections
+    ground_node.connect(&GND);
+    source_node.connect(&Source);
+
+    // Memory control nodes, the owner connects the memory side
+    NME_node.connect(&Not_OE.Out1);
+    NWE_node.connect(&Not_WE.Out1);
+    ground_node.connect(&Not_WE.In1);
+
+    // Connect MAR Latch
+    source_node.connect(&mar.OutputEnable);
+    
+    // Clock enable
+    source_node.connect(&clk.Enable);
+    
+    // unclear counters
+    source_node.connect(&rc.Clear);
+    source_node.connect(&pc.Clear);
+
+    // disable laod for now
+    source_node.connect(&pc.Load);
+
+    // PC setup
+    source_node.connect(&pc.OutputEnable);
+
+    // IR setup
+    source_node.connect(&ir.OutputEnable);
+    #ifdef DISABLE_IR_OUT
+    ground_node.connect(&irb.OutputEnable);
+    #endif
+    
+    // Connect clock to ring counter
+    CLK_Node.connect(&clk.Clk);
+    CLK_Node.connect(&rc.Clock);
+    CLK_Node.connect(&pc.Clock);
+    
+    // Connect ring counter to 
+    RC1_Node.connect(&rc.Q_pins.pins[0]);
+    RC2_Node.connect(&rc.Q_pins.pins[1]);
+    RC3_Node.connect(&rc.Q_pins.pins[2]);
+    RC4_Node.connect(&rc.Q_pins.pins[3]);
+    RC5_Node.connect(&rc.Q_pins.pins[4]);
+
+    // Connect Op decoder to high 4 bits of IR
+    for (int i = 0;i < 4;i++) 
+    {
+        OPCode[i].connect(&ir.Q_pins.pins[i+4]);
+    }
+
+    // Connect OPCode to the decoders
+    for (int i = 0;i < 3;i++) 
+    {
+        OPCode[i].connect(&IRDecoderL.D_pins.pins[i]);
+        OPCode[i].connect(&IRDecoderH.D_pins.pins[i]);
+    }
+    
+    // Op code high bit should be tied to both deoceders enable, IRL_OE = ! Opcode[3]
+    OPCode[3].connect(&Not_IRLe.In1);
+    OPCode[3].connect(&IRDecoderH.OutputEnable);
+    
+    NOPC4.connect(&Not_IRLe.Out1);
+    NOPC4.connect(&IRDecoderL.OutputEnable);
+
+    // Sequencing buffers for instructions
+    RC4_Node.connect(&Seq1Buffer.OutputEnable);
+    RC5_Node.connect(&Seq2Buffer.OutputEnable);
+
+    #ifdef MICROCODE_CONTROL
+    // Control word from the microcode ROM, one lookup per T-state
+    wireMicrocode();
+    #else
+    // Connect control to ring counter
+    // Fixed Instruction is Fetch
+    RC1_Node.connect(&pcb.OutputEnable);
+    RC1_Node.connect(&mar.LatchEnable); // add to OR Gate
+    RC2_Node.connect(&pc.Count);
+    RC3_Node.connect(&Not_OE.In1);      // Add to OR Gate
+    RC3_Node.connect(&ir.LatchEnable);
+    #endif
+}
+
+#ifdef MICROCODE_CONTROL
+void Sap2Core::wireMicrocode()
+{
+    LazyNode* t_state[SAP2_T_STATES] = {&RC1_Node, &RC2_Node, &RC3_Node, &RC4_Node, &RC5_Node};
+
+    for (int lane = 0; lane < MICROCODE_LANES; lane++)
+    {
+        AT28C64& rom = ucode[lane];
+        rom.loadProgram(microcode.image(lane), MICROCODE_ROM_SIZE);
+
+        // Address {opcode, T-state, Z, C}
+        for (int i = 0; i < 4; i++)
+        {
+            OPCode[i].connect(&rom.addr_pins.pins[i]);
+        }
+        for (int i = 0; i < SAP2_T_STATES; i++)
+        {
+            t_state[i]->connect(&rom.addr_pins.pins[4 + i]);
+        }
+
+        // No ALU in the netlist yet, flags read as 0. A11 and A12 unused
+        for (int i = 9; i < rom.addr_pins.num_pins; i++)
+        {
+            ground_node.connect(&rom.addr_pins.pins[i]);
+        }
+
+        // Always reading
+        ground_node.connect(&rom.ChipEnable);
+        ground_node.connect(&rom.OutputEnable);
+        source_node.connect(&rom.WriteEnable);
+
+        for (int i = 0; i < rom.io_pins.num_pins; i++)
+        {
+            int bit = 8 * lane + i;
+            if (bit < MICROCODE_BITS)
+            {
+                Control[bit].connect(&rom.io_pins.pins[i]);
+            }
+        }
+    }
+
+    // Control lines with a part to drive, Mem_Load waits for the A register
+    Control[ctrlBit(kCtrlPcOut)].connect(&pcb.OutputEnable);
+    Control[ctrlBit(kCtrlMarLoad)].connect(&mar.LatchEnable);
+    Control[ctrlBit(kCtrlPcCount)].connect(&pc.Count);
+    Control[ctrlBit(kCtrlMemOut)].connect(&Not_OE.In1);
+    Control[ctrlBit(kCtrlIrLoad)].connect(&ir.LatchEnable);
+    #ifndef DISABLE_IR_OUT
+    Control[ctrlBit(kCtrlIrOut)].connect(&irb.OutputEnable);
+    #endif
+}
+#endif
+
+// ==============================================
+// Per-cycle observation, shared by app.cpp and Sap2System
+
+void Sap2Core::trackGroups(LazyDrivers& drivers)
+{
+    drivers.add(&IRDecoderL_Q);
+    drivers.add(&IRDecoderH_Q);
+    #ifdef MICROCODE_CONTROL
+    for (LazyPinGroup& group : UCode_Q)
+    {
+        drivers.add(&group);
+    }
+    #endif
+}
+
+bool Sap2Core::outLoad()
+{
+    #ifdef MICROCODE_CONTROL
+    return Control[ctrlBit(kCtrlOutLoad)].get_value() == kLogicHigh;
+    #else
+    // Out_Load stand-in until the sequencer drives it: OUT decoded during RC5
+    return (RC5_Node.get_value() == kLogicHigh) &&
+           (controlHBus.get_value().byte & (1 << (kOpOUT - 8)));
+    #endif
+}
+
+void Sap2Core::hashState(StateHash& hash)
+{
+    for (LazyNode* node : m_hashNodes)
+    {
+        hash.add((uint64_t)node->get_value());
+    }
+    for (Bus8bit* bus : buses)
+    {
+        hash.add(bus->get_value().byte);
+    }
+    hash.add((uint64_t)pc.get_value());
+    hash.add((uint64_t)(uint8_t)mar.getLatchValue());
+    hash.add((uint64_t)(uint8_t)ir.getLatchValue());
+}
+
+// ==============================================
+// Elaboration, pin roles per part type. The connections are read back
+// from the nodes, so wire() stays the only netlist
+
+static int describePart(Elaborator& elab, Latch& latch, const char* name)
+{
+    int e = elab.addPart(&latch, name, Elaborator::kSequential);
+    elab.input(e, latch.D_pins, "D");
+    elab.input(e, &latch.LatchEnable, "LatchEnable");
+    elab.input(e, &latch.OutputEnable, "OutputEnable");
+    elab.output(e, latch.Q_pins);
+    return e;
+}
+
+static int describePart(Elaborator& elab, Buffer& buffer, const char* name)
+{
+    int e = elab.addPart(&buffer, name, Elaborator::kCombinational);
+    elab.input(e, buffer.D_pins, "D");
+    elab.enable(e, &buffer.OutputEnable, "OutputEnable", kLogicHigh);
+    elab.output(e, buffer.Q_pins);
+    return e;
+}
+
+static int describePart(Elaborator& elab, Counter& counter, const char* name)
+{
+    int e = elab.addPart(&counter, name, Elaborator::kSequential);
+    elab.input(e, counter.D_pins, "D");
+    elab.input(e, &counter.Clock, "Clock");
+    elab.input(e, &counter.Clear, "Clear");
+    elab.input(e, &counter.Load, "Load");
+    elab.input(e, &counter.Count, "Count");
+    elab.input(e, &counter.OutputEnable, "OutputEnable");
+    elab.output(e, counter.Q_pins);
+    return e;
+}
+
+static int describePart(Elaborator& elab, RingCounter& counter, const char* name)
+{
+    int e = elab.addPart(&counter, name, Elaborator::kSequential);
+    elab.input(e, &counter.Clock, "Clock");
+    elab.input(e, &counter.Clear, "Clear");
+    elab.output(e, counter.Q_pins);
+    return e;
+}
+
+static int describePart(Elaborator& elab, Clock& clock, const char* name)
+{
+    int e = elab.addPart(&clock, name, Elaborator::kSequential);
+    elab.input(e, &clock.Enable, "Enable");
+    elab.output(e, &clock.Clk);
+    return e;
+}
+
+static int describePart(Elaborator& elab, NotGate& gate, const char* name)
+{
+    int e = elab.addPart(&gate, name, Elaborator::kInverter);
+    elab.input(e, &gate.In1, "In1");
+    elab.output(e, &gate.Out1);
+    return e;
+}
+
+static int describePart(Elaborator& elab, Decoder3to8& decoder, const char* name)
+{
+    int e = elab.addPart(&decoder, name, Elaborator::kCombinational);
+    elab.input(e, decoder.D_pins, "D");
+    elab.enable(e, &decoder.OutputEnable, "OutputEnable", kLogicHigh);
+    elab.output(e, decoder.Q_pins);
+    return e;
+}
+
+int Sap2Core::describeMemory(Elaborator& elab, AT28C64& rom, const char* name)
+{
+    int e = elab.addPart(&rom, name, Elaborator::kSequential);
+    elab.input(e, rom.addr_pins, "A");
+    elab.input(e, &rom.ChipEnable, "ChipEnable");
+    elab.input(e, &rom.OutputEnable, "OutputEnable");
+    elab.input(e, &rom.WriteEnable, "WriteEnable");
+    elab.output(e, rom.io_pins);
+    return e;
+}
+
+void Sap2Core::describe(Elaborator& elab)
+{
+    elab.addRail(&GND, "GND", kLogicLow);
+    elab.addRail(&Source, "VCC", kLogicHigh);
+
+    struct NamedNode
+    {
+        LazyNode* node;
+        const char* name;
+    };
+    const NamedNode named[] = {
+        {&ground_node, "ground_node"},
+        {&source_node, "source_node"},
+        {&ME_node, "ME_node"},
+        {&WE_node, "WE_node"},
+        {&MCE_node, "MCE_node"},
+        {&LM_Node, "LM_Node"},
+        {&CP_Node, "CP_Node"},
+        {&LP_Node, "LP_Node"},
+        {&PE_Node, "PE_Node"},
+        {&LI_Node, "LI_Node"},
+        {&IE_Node, "IE_Node"},
+        {&CLK_Node, "CLK_Node"},
+        {&RC1_Node, "RC1_Node"},
+        {&RC2_Node, "RC2_Node"},
+        {&RC3_Node, "RC3_Node"},
+        {&RC4_Node, "RC4_Node"},
+        {&RC5_Node, "RC5_Node"},
+        {&OPCode[0], "OPCode[0]"},
+        {&OPCode[1], "OPCode[1]"},
+        {&OPCode[2], "OPCode[2]"},
+        {&OPCode[3], "OPCode[3]"},
+        {&NOPC4, "NOPC4"},
+        {&NME_node, "NME_node"},
+        {&NWE_node, "NWE_node"}
+    };
+    for (const NamedNode& n : named)
+    {
+        elab.addNode(n.node, n.name);
+    }
+
+    describePart(elab, mar, "mar");
+    describePart(elab, ir, "ir");
+    describePart(elab, irb, "irb");
+    describePart(elab, pc, "pc");
+    describePart(elab, pcb, "pcb");
+    describePart(elab, rc, "rc");
+    describePart(elab, clk, "clk");
+    describePart(elab, Not_OE, "Not_OE");
+    describePart(elab, Not_WE, "Not_WE");
+    describePart(elab, Not_IRLe, "Not_IRLe");
+    describePart(elab, IRDecoderL, "IRDecoderL");
+    describePart(elab, IRDecoderH, "IRDecoderH");
+    describePart(elab, Seq1Buffer, "Seq1Buffer");
+    describePart(elab, Seq2Buffer, "Seq2Buffer");
+
+    #ifdef MICROCODE_CONTROL
+    const char* ucode_names[MICROCODE_LANES] = {"ucode[0]", "ucode[1]", "ucode[2]"};
+    for (int lane = 0; lane < MICROCODE_LANES; lane++)
+    {
+        describeMemory(elab, ucode[lane], ucode_names[lane]);
+    }
+    for (int i = 0; i < MICROCODE_BITS; i++)
+    {
+        elab.addNode(&Control[i], kCtrlNames[i]);
+    }
+    #endif
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    One 8SAP2 CPU as a reusable subcircuit
+
+    Everything of the CPU except memory: registers, buffers, ring counter,
+    clock, op code decode and the control unit, with its own rails, nodes
+    and buses. wire() makes the internal connections. The owner connects
+    memory to marBus (address), mainBus (data) and NME/NWE, adds the lists
+    to its step loop and drives clk.Clk.
+
+    app.hpp builds the single CPU from one core, Sap2System shares one
+    AT28C64 between several.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <sim.hpp>
+#include <Bus.hpp>
+#include <Latch.hpp>
+#include <Buffer.hpp>
+#include <Counter.hpp>
+#include <Clock.hpp>
+#include <Logic.hpp>
+#include <Decoder3to8.hpp>
+#include <AT28C64.hpp>
+
+#include <LazyNode.hpp>
+#include <MicrocodeRom.hpp>
+#include <StateHash.hpp>
+
+// Subcircuit options, shared by every translation unit that builds a core.
+// MICROCODE_CONTROL replaces the discrete ring counter decode with the
+// microcode ROMs, build with -DMICROCODE_CONTROL to use it
+#define DISABLE_IR_OUT
+// #define MICROCODE_CONTROL
+
+using namespace DCSim;
+using namespace Componenets;
+using namespace Vendor;
+using namespace Atmel;
+
+class Elaborator;
+
+class Sap2Core
+{
+public:
+    Sap2Core();
+
+    // Internal connections, once
+    void wire();
+
+    // Rails, nodes and part pin roles for elaboration, after wire()
+    void describe(Elaborator& elab);
+    static int describeMemory(Elaborator& elab, AT28C64& rom, const char* name);
+
+    // Hand the pin groups to the owner's LazyDrivers
+    void trackGroups(LazyDrivers& drivers);
+
+    // Out_Load for the owner's output register, read on a rising edge
+    bool outLoad();
+
+    // Node, bus and register state of one cycle, the caller adds its own and commits
+    void hashState(StateHash& hash);
+
+    // ==========================
+    // Electrical Sources
+
+    SourcePin Source;
+    GroundPin GND;
+
+    // ==========================
+    // Electrical Nodes
+
+    LazyNode ground_node;
+    LazyNode source_node;
+
+    LazyNode ME_node;
+    LazyNode WE_node;
+    LazyNode MCE_node;
+    LazyNode LM_Node;
+    LazyNode CP_Node;
+    LazyNode LP_Node;
+    LazyNode PE_Node;
+    LazyNode LI_Node;
+    LazyNode IE_Node;
+    LazyNode CLK_Node;
+
+    LazyNode RC1_Node;
+    LazyNode RC2_Node;
+    LazyNode RC3_Node;
+    LazyNode RC4_Node;
+    LazyNode RC5_Node;
+
+    LazyNode OPCode[4];
+
+    LazyNode NOPC4;
+
+    LazyNode NME_node;
+    LazyNode NWE_node;
+
+    // ==========================
+    // Components
+
+    // Memory Address Register and Instruction Register
+    Latch mar;
+    Latch ir;
+
+    // IR and PC bus buffers
+    Buffer irb;
+    Buffer pcb;
+
+    // Program counter
+    Counter pc;
+
+    // Ring Counter
+    RingCounter rc;
+
+    // Clock, Clk is driven by the owner
+    Clock clk;
+
+    NotGate Not_OE;
+    NotGate Not_WE;
+    NotGate Not_IRLe;
+
+    // decoders
+    Decoder3to8 IRDecoderL;
+    Decoder3to8 IRDecoderH;
+
+    // Instruction Control Logic
+    // OR EEPROM Output Enable
+    OrGate OrOE;
+
+    // Buffer
+    Buffer Seq1Buffer;
+    Buffer Seq2Buffer;
+
+    // ==========================
+    // Bus nodes
+
+    Bus8bit mainBus;
+    Bus8bit marBus;
+    Bus8bit pcBus;
+    Bus8bit irBus;
+
+    Bus8bit controlLBus;
+    Bus8bit controlHBus;
+
+    // ==========================
+    // Cached pin group reads
+
+    LazyPinGroup IRDecoderL_Q;
+    LazyPinGroup IRDecoderH_Q;
+
+    // ==========================
+    // Microcoded control unit, one AT28C64 per control word byte lane
+
+    #ifdef MICROCODE_CONTROL
+    AT28C64 ucode[MICROCODE_LANES];
+
+    // 20 bit control bus, indexed by control bit
+    LazyNode Control[MICROCODE_BITS];
+
+    LazyPinGroup UCode_Q[MICROCODE_LANES];
+
+    // Generated once, every core runs the same ISA
+    static MicrocodeRom microcode;
+    #endif
+
+    // ==========================
+    // Step lists, nodes may be pruned by elaboration
+
+    std::vector<LazyNode*> nodes;
+    std::vector<Component*> parts;
+    std::vector<Bus8bit*> buses;
+
+    Sap2Core(const Sap2Core&) = delete;
+    Sap2Core& operator=(const Sap2Core&) = delete;
+
+private:
+    void attach();
+
+    #ifdef MICROCODE_CONTROL
+    void wireMicrocode();
+    #endif
+
+    // Full node list for hashState(), nodes may be pruned
+    std::vector<LazyNode*> m_hashNodes;
+};
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstring>
+#include <Sap2Cpu.hpp>
+
+const char* const kSap2Mnemonics[16] = {
+    "NOP", "LDI", "LDA", "LDB", "JMP", "JPZ", "JPC", "STR",
+    "LDM", "MOV", "OUT", "STM", "ADD", "SUB", "SFT", "HLT"
+};
+
+Sap2Cpu::Sap2Cpu()
+{
+    memset(mem, 0, sizeof(mem));
+    reset();
+}
+
+void Sap2Cpu::reset()
+{
+    memset(&state, 0, sizeof(state));
+}
+
+void Sap2Cpu::loadProgram(const uint8_t* program, size_t size)
+{
+    if (size > SAP2_MEM_SIZE)
+    {
+        size = SAP2_MEM_SIZE;
+    }
+    memcpy(mem, program, size);
+}
+
+void Sap2Cpu::write(uint8_t addr, uint8_t value, uint64_t cycle)
+{
+    if (io && io->write(addr, value, cycle))
+    {
+        return;
+    }
+
+    mem[addr] = value;
+    if (onWrite)
+    {
+        onWrite(onWriteCtx, addr);
+    }
+}
+
+void Sap2Cpu::step()
+{
+    Sap2State_t& s = state;
+    if (s.halted)
+    {
+        return;
+    }
+
+    // Fetch T1 - T3
+    s.mar = s.pc;
+    s.pc++;
+    s.ir = mem[s.mar];
+
+    uint8_t operand = s.ir & 0x0F;
+    uint64_t done = s.cycles + SAP2_T_STATES;
+
+    // Execute T4 - T5
+    switch (s.ir >> 4)
+    {
+        case kOpNOP:
+            break;
+        case kOpLDI:
+            s.a = operand;
+            break;
+        case kOpLDA:
+            s.mar = operand;
+            s.a = read(s.mar);
+            break;
+        case kOpLDB:
+            s.mar = operand;
+            s.b = read(s.mar);
+            break;
+        case kOpJMP:
+            s.mar = operand;
+            s.pc = read(s.mar);
+            break;
+        case kOpJPZ:
+            s.mar = operand;
+            if (s.zero)
+            {
+                s.pc = read(s.mar);
+            }
+            break;
+        case kOpJPC:
+            s.mar = operand;
+            if (s.carry)
+            {
+                s.pc = read(s.mar);
+            }
+            break;
+        case kOpSTR:
+            s.mar = operand;
+            write(s.mar, s.a, done);
+            break;
+        case kOpLDM:
+            s.mar = s.a;
+            s.a = read(s.mar);
+            break;
+        case kOpMOV:
+            s.b = s.a;
+            break;
+        case kOpOUT:
+            output(s.a, done);
+            break;
+        case kOpSTM:
+        {
+            s.mar = s.a;
+            Sap2State_t alu = s;
+            sap2Add(alu);
+            write(s.mar, alu.a, done);
+            break;
+        }
+        case kOpADD:
+            sap2Add(s);
+            break;
+        case kOpSUB:
+            sap2Sub(s);
+            break;
+        case kOpSFT:
+            sap2Shift(s);
+            break;
+        case kOpHLT:
+            s.halted = true;
+            break;
+    }
+
+    s.cycles += SAP2_T_STATES;
+    s.instructions++;
+}
+
+uint64_t Sap2Cpu::run(uint64_t max_instructions)
+{
+    uint64_t start = state.instructions;
+    while (!state.halted && (state.instructions - start) < max_instructions)
+    {
+        step();
+    }
+    return state.instructions - start;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Behavioral 8SAP2 CPU
+
+    Instruction-level model of the netlist in app.cpp for long program runs.
+    An instruction is one byte, opcode in IR[7:4] and operand in IR[3:0].
+    Every instruction takes one pass of the ring counter:
+
+        T1 | PE, LM     MAR <- PC
+        T2 | CP         PC  <- PC + 1
+        T3 | ME, LI     IR  <- MEM[MAR]
+        T4 | Seq1       execute 1
+        T5 | Seq2       execute 2
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <Peripheral.hpp>
+
+// T-states per instruction, matches RingCounter rc(5)
+#define SAP2_T_STATES   5
+
+// Addressable memory, EEPROM address bits 8->12 are grounded
+#define SAP2_MEM_SIZE   256
+
+enum Sap2Op_E_t
+{
+    kOpNOP = 0,
+    kOpLDI,
+    kOpLDA,
+    kOpLDB,
+    kOpJMP,
+    kOpJPZ,
+    kOpJPC,
+    kOpSTR,
+    kOpLDM,
+    kOpMOV,
+    kOpOUT,
+    kOpSTM,
+    kOpADD,
+    kOpSUB,
+    kOpSFT,
+    kOpHLT
+};
+
+// Indexed by Sap2Op_E_t
+extern const char* const kSap2Mnemonics[16];
+
+struct Sap2State_t
+{
+    uint8_t a;
+    uint8_t b;
+    uint8_t pc;
+    uint8_t ir;
+    uint8_t mar;
+    uint8_t out;
+    bool zero;
+    bool carry;
+    bool halted;
+    uint64_t cycles;
+    uint64_t instructions;
+};
+
+class Sap2Cpu
+{
+public:
+    Sap2Cpu();
+
+    void reset();
+    void loadProgram(const uint8_t* program, size_t size);
+
+    // Reference interpreter, one instruction per call
+    void step();
+    uint64_t run(uint64_t max_instructions);
+
+    // Data read, memory-mapped peripherals shadow memory
+    uint8_t read(uint8_t addr)
+    {
+        uint8_t value;
+        if (io && io->read(addr, value))
+        {
+            return value;
+        }
+        return mem[addr];
+    }
+
+    // Memory write used by STR/STM, the block cache hooks this
+    void write(uint8_t addr, uint8_t value, uint64_t cycle);
+
+    // OUT instruction, cycle is the end of the instruction
+    void output(uint8_t value, uint64_t cycle)
+    {
+        state.out = value;
+        if (outPort)
+        {
+            outPort->write(0, value, cycle);
+        }
+    }
+
+    Sap2State_t state;
+    uint8_t mem[SAP2_MEM_SIZE];
+
+    // Optional I/O, unmapped addresses fall through to memory
+    PeripheralMap* io {nullptr};
+    Peripheral* outPort {nullptr};
+
+    // Called after every memory write, used to invalidate translated code
+    void (*onWrite)(void* ctx, uint8_t addr) {nullptr};
+    void* onWriteCtx {nullptr};
+};
+
+// ALU with status flags, shared by every execution engine
+inline void sap2Add(Sap2State_t& s)
+{
+    unsigned r = (unsigned)s.a + s.b;
+    s.carry = r > 0xFF;
+    s.a = (uint8_t)r;
+    s.zero = (s.a == 0);
+}
+
+inline void sap2Sub(Sap2State_t& s)
+{
+    s.carry = s.a < s.b;
+    s.a = (uint8_t)(s.a - s.b);
+    s.zero = (s.a == 0);
+}
+
+inline void sap2Shift(Sap2State_t& s)
+{
+    s.carry = (s.a & 0x80) != 0;
+    s.a = (uint8_t)(s.a << 1);
+    s.zero = (s.a == 0);
+}
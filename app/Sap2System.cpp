@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <Sap2System.hpp>
+
+Sap2System::Sap2System(int n_cores, uint64_t clock_hz)
+    : arbiter(n_cores), m_clocks(n_cores)
+{
+    m_clock.set_frequency(clock_hz);
+    m_timestep = m_clock.period() / 10;
+
+    // Shared rails and memory
+    m_ground.connect(&m_gnd);
+    m_source.connect(&m_vcc);
+
+    for (int i = N_BUS_BITS; i < m_memory.addr_pins.num_pins; i++)
+    {
+        m_ground.connect(&m_memory.addr_pins.pins[i]);
+    }
+    m_ground.connect(&m_memory.ChipEnable);
+    m_source.connect(&m_memory.WriteEnable);
+    m_memOE.connect(&arbiter.OutputEnable);
+    m_memOE.connect(&m_memory.OutputEnable);
+
+    m_addrBus.attach(arbiter.addr_out_pins);
+    m_addrBus.attach({N_BUS_BITS, m_memory.addr_pins.pins});
+    m_dataBus.attach({N_BUS_BITS, &m_memory.io_pins.pins[0]});
+    m_dataBus.attach(arbiter.data_in_pins);
+
+    m_nodes = {&m_ground, &m_source, &m_memOE};
+    m_parts = {&m_memory, &arbiter};
+    m_buses = {&m_addrBus, &m_dataBus};
+
+    // Cores, each on its own arbiter port
+    for (int i = 0; i < n_cores; i++)
+    {
+        m_cores.emplace_back(new Sap2Core());
+        Sap2Core& core = *m_cores.back();
+        core.wire();
+
+        BusArbiter::Port& port = arbiter.port(i);
+        core.marBus.attach(port.addr_pins);
+        core.mainBus.attach(port.data_pins);
+        #ifdef MICROCODE_CONTROL
+        core.Control[ctrlBit(kCtrlMemOut)].connect(&port.request);
+        #else
+        core.RC3_Node.connect(&port.request);
+        #endif
+
+        m_nodes.insert(m_nodes.end(), core.nodes.begin(), core.nodes.end());
+        m_parts.insert(m_parts.end(), core.parts.begin(), core.parts.end());
+        m_buses.insert(m_buses.end(), core.buses.begin(), core.buses.end());
+
+        // Rails hold before the first step, as elaboration leaves them in
+        // app.cpp, so clk.Enable is already high when step 0 gates the clock
+        core.ground_node.evaluate();
+        core.source_node.evaluate();
+    }
+    m_ground.evaluate();
+    m_source.evaluate();
+
+    arbiter.setSettleSteps(settleDepth());
+}
+
+// ==============================================
+// Settle time from the step order
+
+template <typename T>
+static int position(const std::vector<T*>& list, const T* item, int base)
+{
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        if (list[i] == item)
+        {
+            return base + (int)i;
+        }
+    }
+    return -1;
+}
+
+// A stage later in step() sees the change in the same step, otherwise in the next
+static int hop(int from, int to)
+{
+    return (to > from) ? 0 : 1;
+}
+
+int Sap2System::nodeAt(const LazyNode* node) const
+{
+    return position(m_nodes, node, 0);
+}
+
+int Sap2System::partAt(const Component* part) const
+{
+    return position(m_parts, part, (int)m_nodes.size());
+}
+
+int Sap2System::busAt(const Bus8bit* bus) const
+{
+    return position(m_buses, bus, (int)(m_nodes.size() + m_parts.size()));
+}
+
+// Steps after the grant step until the memory's data is on the owner's
+// mainBus. The core may clock on the step after that
+int Sap2System::settleDepth() const
+{
+    int arb = partAt(&arbiter);
+    int mem = partAt(&m_memory);
+    int addr = busAt(&m_addrBus);
+    int oe = nodeAt(&m_memOE);
+    int data = busAt(&m_dataBus);
+
+    // Address and OutputEnable to the memory, its data back to the arbiter
+    int depth = std::max(hop(arb, addr) + hop(addr, mem), hop(arb, oe) + hop(oe, mem));
+    depth += hop(mem, data) + hop(data, arb);
+
+    // Then from the owner's port onto its mainBus
+    int port = 0;
+    for (const std::unique_ptr<Sap2Core>& core : m_cores)
+    {
+        port = std::max(port, hop(arb, busAt(&core->mainBus)));
+    }
+    return depth + port;
+}
+
+void Sap2System::loadProgram(const uint8_t* program, size_t size)
+{
+    m_image.assign(program, program + size);
+    m_memory.loadProgram(m_image.data(), (int)size);
+}
+
+void Sap2System::step()
+{
+    LazyPinGroup::advanceEpoch();
+
+    // Shared clock, gated per core by the arbiter
+    bool level = m_clock.level(m_time);
+    bool rising = level && !m_level;
+    m_level = level;
+    m_edges += rising;
+
+    for (int i = 0; i < cores(); i++)
+    {
+        Clock& clk = m_cores[i]->clk;
+        CoreClock& c = m_clocks[i];
+        bool stalled = arbiter.stalled(i);
+        bool high = level && !stalled && (clk.Enable.get_value() == kLogicHigh);
+
+        clk.Clk.set_value(high ? kLogicHigh : kLogicLow);
+        c.rose = high && !c.high;
+        c.cycles += c.rose;
+        c.stalls += (rising && stalled);
+        c.high = high;
+    }
+
+    for (LazyNode* node : m_nodes)
+    {
+        node->evaluate();
+    }
+    for (Component* part : m_parts)
+    {
+        part->evaluate();
+    }
+    for (Bus8bit* bus : m_buses)
+    {
+        bus->evaluate();
+    }
+
+    if (m_onCycle)
+    {
+        for (int i = 0; i < cores(); i++)
+        {
+            if (m_clocks[i].rose)
+            {
+                m_onCycle(i);
+            }
+        }
+    }
+
+    m_time += m_timestep;
+    m_steps++;
+}
+
+void Sap2System::run(uint64_t n_steps)
+{
+    for (uint64_t i = 0; i < n_steps; i++)
+    {
+        step();
+    }
+}
+
+void Sap2System::report() const
+{
+    printf(" = = = Arbitration (%d cores) = = = \n", cores());
+    for (int i = 0; i < cores(); i++)
+    {
+        const ArbiterStats& s = arbiter.port(i).stats;
+        printf("Core %2d | Cycles: %6llu |\t Stalled: %6llu |\t Grants: %6llu |\t Wait: %6llu / %6llu steps |\t Max wait: %llu\n",
+               i, (unsigned long long)m_clocks[i].cycles, (unsigned long long)m_clocks[i].stalls,
+               (unsigned long long)s.grants, (unsigned long long)s.waitSteps,
+               (unsigned long long)s.requestSteps, (unsigned long long)s.maxWait);
+    }
+    uint64_t n = arbiter.steps ? arbiter.steps : 1;
+    printf("Bus | Settle: %d steps |\t Contended: %.1f%% |\t Idle: %.1f%% of %llu steps\n", arbiter.settleSteps(),
+           100.0 * arbiter.contendedSteps / n, 100.0 * arbiter.idleSteps / n, (unsigned long long)arbiter.steps);
+}
+
+// ==============================================
+// Scaling workload
+
+void runScaling(const uint8_t* program, size_t size, int max_cores, uint64_t n_steps)
+{
+    printf(" = = = 8SAP2 Multicore Scaling = = = \n");
+    printf("Steps: %llu per run\n", (unsigned long long)n_steps);
+
+    std::vector<int> sizes;
+    for (int n = 1; n < max_cores; n *= 2)
+    {
+        sizes.push_back(n);
+    }
+    sizes.push_back(max_cores);
+
+    for (size_t k = 0; k < sizes.size(); k++)
+    {
+        int n = sizes[k];
+        Sap2System sys(n);
+        sys.loadProgram(program, size);
+
+        auto t0 = std::chrono::steady_clock::now();
+        sys.run(n_steps);
+        auto t1 = std::chrono::steady_clock::now();
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+        if (sec <= 0)
+        {
+            sec = 1e-9;
+        }
+
+        uint64_t cycles = 0;
+        uint64_t stalls = 0;
+        for (int i = 0; i < n; i++)
+        {
+            cycles += sys.coreCycles(i);
+            stalls += sys.stallCycles(i);
+        }
+        uint64_t possible = sys.edges() * n;
+        uint64_t steps = sys.arbiter.steps ? sys.arbiter.steps : 1;
+
+        printf("Cores: %3d |\t Parts: %5zu |\t Nodes: %5zu |\t Buses: %4zu |\t Steps/s: %9.0f |\t Core cycles/s: %9.0f |\t Stalled: %5.1f%% |\t Contended: %5.1f%%\n",
+               n, sys.partCount(), sys.nodeCount(), sys.busCount(), n_steps / sec, cycles / sec,
+               possible ? 100.0 * stalls / possible : 0.0, 100.0 * sys.arbiter.contendedSteps / steps);
+
+        if (k + 1 == sizes.size())
+        {
+            sys.report();
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Several 8SAP2 cores sharing one AT28C64
+
+    Every core is a full Sap2Core. The shared memory sits on its own
+    address and data buses behind a BusArbiter:
+
+        core.marBus     -> port.addr    addr_out -> addrBus -> memory A0 - A7
+        core.mainBus    <- port.data    data_in  <- dataBus <- memory IO
+        core Mem_Out    -> port.request
+        arbiter OE      -> memory OE
+
+    All cores run off one TickClock, 10 steps per period as in app.cpp.
+    A stalled core has its clock held low, it loses cycles instead of
+    latching a bus it does not own. The arbiter's settle time is the depth
+    of the grant -> memory -> owner's mainBus path in step() order.
+
+    runScaling() is the scaling workload: 1, 2, 4 .. N core systems run for
+    the same number of steps, reporting simulator throughput, lost cycles
+    and bus contention per size.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <Sap2Core.hpp>
+#include <BusArbiter.hpp>
+#include <Timebase.hpp>
+
+class Sap2System
+{
+public:
+    explicit Sap2System(int n_cores, uint64_t clock_hz = 100);
+
+    void loadProgram(const uint8_t* program, size_t size);
+
+    // One timestep
+    void step();
+    void run(uint64_t n_steps);
+
+    // Called after every step in which a core's clock rose, with its index
+    typedef std::function<void(int core)> CycleFn;
+    void onCycle(CycleFn fn) { m_onCycle = fn; }
+
+    int cores() const { return (int)m_cores.size(); }
+    Sap2Core& core(int i) { return *m_cores[i]; }
+
+    uint64_t steps() const { return m_steps; }
+    uint64_t edges() const { return m_edges; }
+    uint64_t coreCycles(int i) const { return m_clocks[i].cycles; }
+    uint64_t stallCycles(int i) const { return m_clocks[i].stalls; }
+
+    size_t partCount() const { return m_parts.size(); }
+    size_t nodeCount() const { return m_nodes.size(); }
+    size_t busCount() const { return m_buses.size(); }
+
+    void report() const;
+
+    BusArbiter arbiter;
+
+private:
+    struct CoreClock
+    {
+        bool high {false};
+        bool rose {false};
+        uint64_t cycles {0};
+        uint64_t stalls {0};    // clock edges lost to arbitration
+    };
+
+    std::vector<std::unique_ptr<Sap2Core>> m_cores;
+    std::vector<CoreClock> m_clocks;
+
+    // Shared memory
+    AT28C64 m_memory;
+    std::vector<uint8_t> m_image;
+
+    SourcePin m_vcc;
+    GroundPin m_gnd;
+    LazyNode m_ground;
+    LazyNode m_source;
+    LazyNode m_memOE;
+    Bus8bit m_addrBus;
+    Bus8bit m_dataBus;
+
+    TickClock m_clock;
+    tick_t m_timestep;
+    tick_t m_time {0};
+    bool m_level {false};
+    uint64_t m_steps {0};
+    uint64_t m_edges {0};
+
+    std::vector<LazyNode*> m_nodes;
+    std::vector<Component*> m_parts;
+    std::vector<Bus8bit*> m_buses;
+
+    CycleFn m_onCycle;
+
+    // Position in step(): nodes, then parts, then buses
+    int nodeAt(const LazyNode* node) const;
+    int partAt(const Component* part) const;
+    int busAt(const Bus8bit* bus) const;
+    int settleDepth() const;
+};
+
+// Throughput versus core count, every power of two up to max_cores
+void runScaling(const uint8_t* program, size_t size, int max_cores, uint64_t n_steps);
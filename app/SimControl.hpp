@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Scripted control of the 8SAP2 circuit
+
+    The circuit is the set of globals in app.hpp, so there is one per
+    process. These calls build and drive it one timestep at a time for the
+    Python module in python/; run() is the same loop with the logs and
+    reports on top.
+
+    Signal tracing is off by default. setCapacity(n) keeps the last n
+    timesteps in a fixed ring, older samples are overwritten, so a long
+    run never grows it. Read it with copy(), oldest sample first.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include <Timebase.hpp>
+#include <OutputStream.hpp>
+
+// AT28C64, 8K x 8
+#define SIM_EEPROM_SIZE     8192
+
+// RC1 - RC5
+#define SIM_RC_SIGNALS      5
+
+struct SignalTrace
+{
+    std::vector<tick_t> time;
+    std::vector<uint8_t> clk;
+    std::vector<uint8_t> rc[SIM_RC_SIGNALS];
+
+    // 0 turns tracing off and frees the buffers
+    void setCapacity(size_t n)
+    {
+        std::vector<tick_t>(n).swap(time);
+        std::vector<uint8_t>(n).swap(clk);
+        for (std::vector<uint8_t>& sig : rc)
+        {
+            std::vector<uint8_t>(n).swap(sig);
+        }
+        clear();
+    }
+
+    size_t capacity() const { return time.size(); }
+    bool enabled() const { return !time.empty(); }
+
+    void push(tick_t t, uint8_t c, const uint8_t (&r)[SIM_RC_SIGNALS])
+    {
+        time[m_next] = t;
+        clk[m_next] = c;
+        for (int i = 0; i < SIM_RC_SIGNALS; i++)
+        {
+            rc[i][m_next] = r[i];
+        }
+
+        m_next = (m_next + 1 == capacity()) ? 0 : m_next + 1;
+        if (m_count < capacity())
+        {
+            m_count++;
+        }
+        else
+        {
+            m_dropped++;
+        }
+    }
+
+    // size() samples of one signal into out, oldest first
+    template <typename T>
+    void copy(const std::vector<T>& sig, T* out) const
+    {
+        size_t first = oldest();
+        size_t head = std::min(capacity() - first, m_count);
+        std::copy(sig.begin() + first, sig.begin() + first + head, out);
+        std::copy(sig.begin(), sig.begin() + (m_count - head), out + head);
+    }
+
+    void clear()
+    {
+        m_next = 0;
+        m_count = 0;
+        m_dropped = 0;
+    }
+
+    size_t size() const { return m_count; }
+
+    // Index of the oldest sample, 0 until the ring wraps
+    size_t oldest() const { return (m_count < capacity()) ? 0 : m_next; }
+    uint64_t dropped() const { return m_dropped; }
+
+private:
+    size_t m_next {0};
+    size_t m_count {0};
+    uint64_t m_dropped {0};     // overwritten since the last clear()
+};
+
+// Wire up the circuit, once per process
+void setup();
+bool isSetup();
+
+// Copies into the EEPROM image and loads it into the part. program may be
+// programImage(), the part only sees edits to the image after a load
+void loadProgram(const uint8_t* program, size_t size);
+uint8_t* programImage();
+
+// Microcode lane image the ROMs were loaded from at setup(), nullptr
+// without MICROCODE_CONTROL
+uint8_t* microcodeImage(int lane);
+
+// One timestep, returns true on a rising clock edge
+bool simStep();
+
+// Print a line per clock edge, on for run()
+void simVerbose(bool verbose);
+
+tick_t simTime();
+tick_t simTimestep();
+tick_t simPeriod();
+uint64_t simSteps();
+uint64_t simCycles();
+
+// Node value (0/1) or bus byte by name, -1 when the name is unknown
+int readNode(const char* name);
+int readBus(const char* name);
+std::vector<const char*> nodeNames();
+std::vector<const char*> busNames();
+
+// Architectural registers
+int readPc();
+int readMar();
+int readIr();
+int readOut();
+uint32_t readControlWord();
+
+SignalTrace& signalTrace();
+
+// Keep output register writes in memory, takeOutputs() returns those since the last call
+void captureOutputs();
+std::vector<OutputRecord> takeOutputs();
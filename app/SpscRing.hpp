@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Lock-free single producer / single consumer ring buffer
+
+    Capacity is rounded up to a power of two. The producer only writes
+    m_head and the consumer only writes m_tail, each on its own cache line,
+    so neither side takes a lock or a read-modify-write.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity)
+        {
+            n <<= 1;
+        }
+        m_buffer.resize(n);
+        m_mask = n - 1;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Producer side
+    bool push(const T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == capacity())
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == capacity())
+            {
+                return false;
+            }
+        }
+        m_buffer[head & m_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, copies up to max items and returns the count
+    size_t popBatch(T* out, size_t max)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t n = head - tail;
+        if (n > max)
+        {
+            n = max;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = m_buffer[(tail + i) & m_mask];
+        }
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> m_buffer;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_head {0};
+    size_t m_tailCache {0};                     // producer's view of m_tail
+    alignas(64) std::atomic<size_t> m_tail {0};
+};
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <StateHash.hpp>
+
+static const char kMagic[8] = {'8', 'S', 'A', 'P', 'H', 'A', 'S', 'H'};
+static const uint64_t kCycleSeed = 0xCBF29CE484222325ULL;
+
+StateHash::StateHash(uint32_t stride)
+    : m_stride(stride ? stride : 1), m_cycle(kCycleSeed)
+{
+}
+
+uint64_t StateHash::commit()
+{
+    m_rolling = mix(m_rolling * 0x9E3779B97F4A7C15ULL + mix(m_cycle));
+    m_cycle = kCycleSeed;
+    m_cycles++;
+
+    if ((m_cycles % m_stride) != 0)
+    {
+        return m_rolling;
+    }
+    m_stream.push_back(m_rolling);
+
+    if (m_checking && !m_diverged)
+    {
+        size_t idx = m_stream.size() - 1;
+        if (idx >= m_golden.size() || m_golden[idx] != m_rolling)
+        {
+            m_diverged = true;
+            m_divergentCycle = m_cycles;
+            m_expected = (idx < m_golden.size()) ? m_golden[idx] : 0;
+            m_got = m_rolling;
+        }
+    }
+    return m_rolling;
+}
+
+// ==============================================
+// Stream files
+
+bool StateHash::save(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        printf("StateHash: cannot write %s\n", path);
+        return false;
+    }
+
+    uint32_t version = STATE_HASH_VERSION;
+    uint64_t count = m_stream.size();
+    bool ok = fwrite(kMagic, 1, sizeof(kMagic), file) == sizeof(kMagic)
+           && fwrite(&version, sizeof(version), 1, file) == 1
+           && fwrite(&m_stride, sizeof(m_stride), 1, file) == 1
+           && fwrite(&m_cycles, sizeof(m_cycles), 1, file) == 1
+           && fwrite(&m_rolling, sizeof(m_rolling), 1, file) == 1
+           && fwrite(&count, sizeof(count), 1, file) == 1
+           && fwrite(m_stream.data(), sizeof(uint64_t), m_stream.size(), file) == m_stream.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok)
+    {
+        printf("StateHash: short write to %s\n", path);
+    }
+    return ok;
+}
+
+bool StateHash::loadGolden(const char* path, uint32_t stride)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        printf("StateHash: cannot read %s\n", path);
+        return false;
+    }
+
+    // Header fields must agree with each other and with the file size
+    // before anything is allocated
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t file_stride = 0;
+    uint64_t cycles = 0;
+    uint64_t final_hash = 0;
+    uint64_t count = 0;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+           && memcmp(magic, kMagic, sizeof(kMagic)) == 0
+           && fread(&version, sizeof(version), 1, file) == 1
+           && version == STATE_HASH_VERSION
+           && fread(&file_stride, sizeof(file_stride), 1, file) == 1
+           && fread(&cycles, sizeof(cycles), 1, file) == 1
+           && fread(&final_hash, sizeof(final_hash), 1, file) == 1
+           && fread(&count, sizeof(count), 1, file) == 1;
+
+    long header = ftell(file);
+    ok = ok && (header > 0) && (fseek(file, 0, SEEK_END) == 0);
+    long size = ftell(file);
+    ok = ok && (size >= header) && (fseek(file, header, SEEK_SET) == 0);
+
+    if (!ok)
+    {
+        printf("StateHash: %s is not a version %d hash stream\n", path, STATE_HASH_VERSION);
+        fclose(file);
+        return false;
+    }
+
+    const char* problem = nullptr;
+    if (file_stride == 0)
+    {
+        problem = "stride 0";
+    }
+    else if (count != cycles / file_stride)
+    {
+        problem = "checkpoint count does not match cycles / stride";
+    }
+    else if ((((uint64_t)(size - header) % sizeof(uint64_t)) != 0) ||
+             (((uint64_t)(size - header) / sizeof(uint64_t)) != count))
+    {
+        problem = "truncated or oversized checkpoint data";
+    }
+    else if ((stride != 0) && (stride != file_stride))
+    {
+        problem = "stride differs from the requested one";
+    }
+
+    if (!problem)
+    {
+        m_golden.resize(count);
+        if (fread(m_golden.data(), sizeof(uint64_t), count, file) != count)
+        {
+            problem = "read error";
+        }
+    }
+    fclose(file);
+
+    if (problem)
+    {
+        printf("StateHash: rejected %s, %s (stride %u, cycles %llu, count %llu, %ld bytes)\n", path, problem,
+               file_stride, (unsigned long long)cycles, (unsigned long long)count, size);
+        m_golden.clear();
+        return false;
+    }
+
+    // Checkpoints only line up when both runs use the same stride
+    m_stride = file_stride;
+    m_goldenStride = file_stride;
+    m_goldenCycles = cycles;
+    m_goldenFinal = final_hash;
+    m_goldenPath = path;
+    m_checking = true;
+    return true;
+}
+
+bool StateHash::report() const
+{
+    printf(" = = = State Hash = = = \n");
+    printf("Cycles: %llu |\t Checkpoints: %zu |\t Stride: %u |\t Hash: %016llx\n",
+           (unsigned long long)m_cycles, m_stream.size(), m_stride, (unsigned long long)m_rolling);
+
+    if (!m_checking)
+    {
+        return true;
+    }
+
+    if (m_diverged)
+    {
+        printf("REGRESSION: diverged from %s at cycle %llu", m_goldenPath.c_str(),
+               (unsigned long long)m_divergentCycle);
+        if (m_goldenStride > 1)
+        {
+            printf(" (within the last %u cycles)", m_goldenStride);
+        }
+        printf(" | expected %016llx got %016llx\n", (unsigned long long)m_expected, (unsigned long long)m_got);
+        return false;
+    }
+
+    if ((m_cycles != m_goldenCycles) || (m_stream.size() != m_golden.size()))
+    {
+        printf("REGRESSION: %llu cycles recorded, golden %s has %llu\n",
+               (unsigned long long)m_cycles, m_goldenPath.c_str(), (unsigned long long)m_goldenCycles);
+        return false;
+    }
+
+    if (m_rolling != m_goldenFinal)
+    {
+        printf("REGRESSION: final hash differs from %s | expected %016llx got %016llx\n",
+               m_goldenPath.c_str(), (unsigned long long)m_goldenFinal, (unsigned long long)m_rolling);
+        return false;
+    }
+
+    printf("Matched golden %s\n", m_goldenPath.c_str());
+    return true;
+}
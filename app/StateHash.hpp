@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Per-cycle state hashing for golden-trace regression
+
+    At every clock edge the caller mixes architectural and node state into a
+    cycle hash with add(), then commit() folds it into a rolling 64 bit hash.
+    Because the hash is rolling, the first checkpoint that differs from the
+    golden stream is where execution first diverged. One checkpoint is kept
+    every stride cycles, 8 bytes each, so the stride trades file size for
+    how closely a divergence is located. The final hash is always stored,
+    a run shorter than the stride is still compared.
+
+    Stream file (little endian):
+        char[8]   "8SAPHASH"
+        uint32    version
+        uint32    stride        cycles between stored checkpoints
+        uint64    cycles        cycles hashed
+        uint64    final         rolling hash after the last cycle
+        uint64    count         cycles / stride
+        uint64    hash[count]
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define STATE_HASH_VERSION 2
+
+// 32 KB per million cycles
+#define STATE_HASH_STRIDE 256
+
+class StateHash
+{
+public:
+    explicit StateHash(uint32_t stride = STATE_HASH_STRIDE);
+
+    // Before the first commit()
+    void setStride(uint32_t stride) { m_stride = stride ? stride : 1; }
+    uint32_t stride() const { return m_stride; }
+
+    void add(uint64_t value)
+    {
+        m_cycle = (m_cycle ^ value) * 0x100000001B3ULL;
+    }
+
+    // Close the current cycle, returns the rolling hash
+    uint64_t commit();
+
+    // Compare against a stored stream while running. The file's stride is
+    // used, a non-zero stride must match it
+    bool loadGolden(const char* path, uint32_t stride = 0);
+
+    // Write the stream recorded so far
+    bool save(const char* path) const;
+
+    uint64_t cycles() const { return m_cycles; }
+    uint64_t rolling() const { return m_rolling; }
+
+    bool checking() const { return m_checking; }
+    bool diverged() const { return m_diverged; }
+    uint64_t divergentCycle() const { return m_divergentCycle; }
+
+    // Prints the regression result, returns false on divergence
+    bool report() const;
+
+private:
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    uint32_t m_stride;
+    uint64_t m_cycle;
+    uint64_t m_rolling {0};
+    uint64_t m_cycles {0};
+    std::vector<uint64_t> m_stream;
+
+    bool m_checking {false};
+    std::string m_goldenPath;
+    uint32_t m_goldenStride {1};
+    uint64_t m_goldenCycles {0};
+    uint64_t m_goldenFinal {0};
+    std::vector<uint64_t> m_golden;
+    bool m_diverged {false};
+    uint64_t m_divergentCycle {0};
+    uint64_t m_expected {0};
+    uint64_t m_got {0};
+};
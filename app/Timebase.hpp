@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Integer simulation timebase
+
+    Simulated time is a 64 bit count of picoseconds, enough for ~213 days
+    of simulated time, so edges stay exact however long the run. Floating
+    point only appears when converting for display.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint64_t tick_t;
+
+const tick_t kTicksPerNs    = 1000ULL;
+const tick_t kTicksPerUs    = 1000ULL * kTicksPerNs;
+const tick_t kTicksPerMs    = 1000ULL * kTicksPerUs;
+const tick_t kTicksPerSec   = 1000ULL * kTicksPerMs;
+
+inline tick_t ticksFromNs(uint64_t ns) { return ns * kTicksPerNs; }
+inline tick_t ticksFromUs(uint64_t us) { return us * kTicksPerUs; }
+inline tick_t ticksFromMs(uint64_t ms) { return ms * kTicksPerMs; }
+inline tick_t ticksFromSec(uint64_t s) { return s * kTicksPerSec; }
+
+inline uint64_t ticksToNs(tick_t t) { return t / kTicksPerNs; }
+
+// Period of an integer frequency, rounded to the nearest tick
+inline tick_t periodFromHz(uint64_t hz)
+{
+    return (kTicksPerSec + hz / 2) / hz;
+}
+
+inline uint64_t hzFromPeriod(tick_t period)
+{
+    return (kTicksPerSec + period / 2) / period;
+}
+
+// ==========================
+// Clock driven from ticks
+
+class TickClock
+{
+public:
+    void set_frequency(uint64_t hz) { set_period(periodFromHz(hz)); }
+
+    void set_period(tick_t period)
+    {
+        m_period = period;
+        m_high = period / 2;
+    }
+
+    tick_t period() const { return m_period; }
+    uint64_t frequency() const { return hzFromPeriod(m_period); }
+
+    // High for the first half of each period, starting at tick 0
+    bool level(tick_t t) const
+    {
+        return (t % m_period) < m_high;
+    }
+
+    // Index of the last rising edge at or before t
+    uint64_t cycle(tick_t t) const
+    {
+        return t / m_period;
+    }
+
+private:
+    tick_t m_period {kTicksPerSec};
+    tick_t m_high {kTicksPerSec / 2};
+};
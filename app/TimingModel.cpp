@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+#include <cstdio>
+#include <TimingModel.hpp>
+
+// Keep at most this many uncaptured arrivals per check
+#define MAX_PENDING_ARRIVALS 32
+
+// ==============================================
+// Construction
+
+int TimingModel::addSignal(const char* name, Probe probe)
+{
+    Signal sig;
+    sig.name = name;
+    sig.probe = probe;
+    if (probe)
+    {
+        sig.value = probe();
+    }
+    m_signals.push_back(sig);
+    return (int)m_signals.size() - 1;
+}
+
+void TimingModel::addLaunch(int clock, int target, const PartTiming& timing)
+{
+    Arc arc;
+    arc.to = target;
+    arc.timing = timing;
+    arc.launch = true;
+    arc.invert = false;
+    m_signals[clock].fanout.push_back(arc);
+}
+
+void TimingModel::addArc(int from, int to, const PartTiming& timing, bool invert, Sensitize sensitize)
+{
+    Arc arc;
+    arc.to = to;
+    arc.timing = timing;
+    arc.launch = false;
+    arc.invert = invert;
+    arc.sensitize = sensitize;
+    m_signals[from].fanout.push_back(arc);
+}
+
+void TimingModel::addEnable(int from, int to, const PartTiming& timing, bool active_low)
+{
+    Arc arc;
+    arc.to = to;
+    arc.timing = timing;
+    arc.launch = false;
+    arc.invert = false;
+    arc.enableOn = active_low ? 0 : 1;
+    m_signals[from].fanout.push_back(arc);
+}
+
+void TimingModel::addCheck(const char* name, int data, int capture, Edge_E_t edge, const PartTiming& timing)
+{
+    Check check;
+    check.name = name;
+    check.data = data;
+    check.capture = capture;
+    check.edge = edge;
+    check.timing = timing;
+    m_checks.push_back(check);
+
+    int id = (int)m_checks.size() - 1;
+    m_signals[data].dataOf.push_back(id);
+    m_signals[capture].captureOf.push_back(id);
+}
+
+// ==============================================
+// Simulation
+
+void TimingModel::clockEdge(int clock, uint64_t tick_ns)
+{
+    if (m_edges > 0)
+    {
+        m_period = tick_ns - m_edgeTick;
+    }
+    m_edgeTick = tick_ns;
+    m_edges++;
+
+    // Sample the functional state the edge produced, the caller waits for it
+    for (Signal& sig : m_signals)
+    {
+        if (sig.probe)
+        {
+            int v = sig.probe();
+            sig.changed = (v != sig.value);
+            sig.value = v;
+        }
+    }
+
+    schedule(Event{clock, m_edges, 0, false, true});
+    schedule(Event{clock, m_edges, 0, true, true});
+
+    // Paths are far shorter than any simulated period, drain them now so
+    // sensitization reads the state of the launching edge
+    uint64_t tick;
+    Event ev;
+    while (m_wheel.pop(UINT64_MAX, tick, ev))
+    {
+        process(ev);
+    }
+}
+
+void TimingModel::schedule(const Event& ev)
+{
+    m_wheel.schedule(m_edgeTick + ev.delay, ev);
+}
+
+void TimingModel::process(const Event& ev)
+{
+    Signal& sig = m_signals[ev.signal];
+
+    if (sig.edge != ev.edge)
+    {
+        sig.edge = ev.edge;
+        sig.hasEarly = false;
+        sig.hasLate = false;
+    }
+
+    // Events arrive in time order, so only the first early and each new
+    // latest late arrival carry information downstream
+    if (ev.late)
+    {
+        if (sig.hasLate && ev.delay <= sig.late)
+        {
+            return;
+        }
+        sig.late = ev.delay;
+        sig.hasLate = true;
+    }
+    else
+    {
+        if (sig.hasEarly)
+        {
+            return;
+        }
+        sig.early = ev.delay;
+        sig.hasEarly = true;
+    }
+
+    for (int id : sig.dataOf)
+    {
+        onData(m_checks[id], ev);
+    }
+    for (int id : sig.captureOf)
+    {
+        onCapture(m_checks[id], ev);
+    }
+
+    for (const Arc& arc : sig.fanout)
+    {
+        Event next = ev;
+        next.signal = arc.to;
+        next.delay = ev.delay + (ev.late ? arc.timing.tpd_max : arc.timing.tpd_min);
+
+        if (arc.launch)
+        {
+            const Signal& target = m_signals[arc.to];
+            if (!target.changed)
+            {
+                continue;
+            }
+            next.value = (target.value != 0);
+        }
+        else
+        {
+            if ((arc.enableOn >= 0) && ((int)ev.value != arc.enableOn))
+            {
+                continue;
+            }
+            if (arc.sensitize && !arc.sensitize())
+            {
+                continue;
+            }
+            next.value = arc.invert ? !ev.value : ev.value;
+        }
+        schedule(next);
+    }
+}
+
+void TimingModel::onData(Check& check, const Event& ev)
+{
+    if (ev.late)
+    {
+        for (Arrival& a : check.pending)
+        {
+            if (a.edge == ev.edge)
+            {
+                a.delay = ev.delay;
+                return;
+            }
+        }
+        if (check.pending.size() >= MAX_PENDING_ARRIVALS)
+        {
+            check.pending.erase(check.pending.begin());
+        }
+        check.pending.push_back(Arrival{ev.edge, ev.delay});
+        return;
+    }
+
+    // Data launched by the capturing edge must not move inside the hold window
+    check.dataEarly = Arrival{ev.edge, ev.delay};
+    if (check.captureLate.edge == ev.edge && ev.delay < check.captureLate.delay + check.timing.th)
+    {
+        check.holdViolations++;
+    }
+}
+
+void TimingModel::onCapture(Check& check, const Event& ev)
+{
+    if ((check.edge == kRisingEdge && !ev.value) || (check.edge == kFallingEdge && ev.value))
+    {
+        return;
+    }
+
+    if (ev.late)
+    {
+        check.captureLate = Arrival{ev.edge, ev.delay};
+        if (check.dataEarly.edge == ev.edge && check.dataEarly.delay < ev.delay + check.timing.th)
+        {
+            check.holdViolations++;
+        }
+        return;
+    }
+
+    // Earliest capture against every arrival launched by an earlier edge
+    check.captures++;
+    std::vector<Arrival> keep;
+    for (const Arrival& a : check.pending)
+    {
+        if (a.edge >= ev.edge)
+        {
+            keep.push_back(a);
+            continue;
+        }
+
+        double cycles = (double)(ev.edge - a.edge);
+        double need = ((double)a.delay + check.timing.tsu - (double)ev.delay) / cycles;
+        if (need > check.worstPeriod)
+        {
+            check.worstPeriod = need;
+        }
+
+        if (m_period > 0)
+        {
+            double slack = cycles * m_period + ev.delay - (double)a.delay - check.timing.tsu;
+            if (!check.slackValid || slack < check.worstSlack)
+            {
+                check.worstSlack = slack;
+                check.slackValid = true;
+            }
+            if (slack < 0)
+            {
+                check.setupViolations++;
+            }
+        }
+    }
+    check.pending.swap(keep);
+}
+
+// ==============================================
+// Reporting
+
+uint64_t TimingModel::setupViolations() const
+{
+    uint64_t n = 0;
+    for (const Check& check : m_checks)
+    {
+        n += check.setupViolations;
+    }
+    return n;
+}
+
+uint64_t TimingModel::holdViolations() const
+{
+    uint64_t n = 0;
+    for (const Check& check : m_checks)
+    {
+        n += check.holdViolations;
+    }
+    return n;
+}
+
+double TimingModel::maxSafeFrequency() const
+{
+    double worst = 0;
+    for (const Check& check : m_checks)
+    {
+        if (check.worstPeriod > worst)
+        {
+            worst = check.worstPeriod;
+        }
+    }
+    return (worst > 0) ? 1e9 / worst : 0;
+}
+
+void TimingModel::report() const
+{
+    printf(" = = = Timing Report = = = \n");
+    printf("Clock edges: %llu |\t Period: %llu ns\n", (unsigned long long)m_edges, (unsigned long long)m_period);
+
+    const Check* critical = nullptr;
+    for (const Check& check : m_checks)
+    {
+        printf("%-16s | Captures: %6llu |\t MinPeriod: %7.1f ns |\t",
+               check.name.c_str(), (unsigned long long)check.captures, check.worstPeriod);
+        if (check.slackValid)
+        {
+            printf("Slack: %12.1f ns |\t", check.worstSlack);
+        }
+        else
+        {
+            printf("Slack: %12s    |\t", "--");
+        }
+        printf("Setup Viol: %llu |\t Hold Viol: %llu\n",
+               (unsigned long long)check.setupViolations, (unsigned long long)check.holdViolations);
+
+        if (!critical || check.worstPeriod > critical->worstPeriod)
+        {
+            critical = &check;
+        }
+    }
+
+    double fmax = maxSafeFrequency();
+    if (fmax > 0)
+    {
+        printf("Max safe clock: %.3f MHz (critical: %s)\n", fmax / 1e6, critical->name.c_str());
+    }
+    else
+    {
+        printf("Max safe clock: no captured paths\n");
+    }
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Propagation delay timing model
+
+    The functional simulation settles instantly inside a timestep. This model
+    runs alongside it: on every rising clock edge the registers whose outputs
+    changed launch an event, events propagate through delay arcs on a timing
+    wheel (ns resolution), and setup/hold windows are checked at capture
+    points in the style of a Verilog $setuphold check.
+
+    Every arrival is kept relative to the clock edge that launched it, so the
+    minimum period of each checked path can be derived and reported as the
+    highest safe clock frequency, independent of the clock used to run.
+
+        CLK ==launch==> RC3 --> Not_OE --> eeprom.OutputEnable --> mainBus
+                                                                      |
+                        RC3 (falling) ------------------ capture --> ir
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <TimingWheel.hpp>
+
+// ==========================
+// Datasheet timing (ns)
+
+struct PartTiming
+{
+    uint32_t tpd_min;   // fastest input -> output change
+    uint32_t tpd_max;   // slowest input -> output valid
+    uint32_t tsu;       // setup before capture edge
+    uint32_t th;        // hold after capture edge
+};
+
+namespace Datasheet
+{
+    // AT28C64 read timing, -15 speed grade
+    const PartTiming AT28C64_tACC   {0, 150, 0, 0};     // address to data valid (tOH = 0)
+    const PartTiming AT28C64_tOE    {10, 70, 0, 0};     // OE to data valid
+    const PartTiming AT28C64_tDF    {0, 50, 0, 0};      // OE high to data float
+
+    // 74HC family at 4.5V, 25C
+    const PartTiming HC04_Not       {3, 19, 0, 0};      // inverter
+    const PartTiming HC164_Ring     {6, 30, 20, 5};     // shift register clk -> Q
+    const PartTiming HC161_Counter  {8, 35, 25, 0};     // counter clk -> Q, ENP/ENT setup
+    const PartTiming HC245_Buffer   {4, 22, 0, 0};      // buffer A -> B
+    const PartTiming HC245_Enable   {6, 38, 0, 0};      // buffer OE -> B (tPZH)
+    const PartTiming HC573_Latch    {6, 30, 12, 5};     // latch D/LE -> Q, D setup/hold to LE
+}
+
+// ==========================
+// Timing model
+
+class TimingModel
+{
+public:
+    typedef std::function<int()> Probe;
+    typedef std::function<bool()> Sensitize;
+
+    enum Edge_E_t
+    {
+        kRisingEdge,
+        kFallingEdge,
+        kAnyEdge
+    };
+
+    // Named timing point, probe (optional) samples its functional value
+    int addSignal(const char* name, Probe probe = Probe());
+
+    // Clock to output arc, only fires when the target's probe changed on the edge
+    void addLaunch(int clock, int target, const PartTiming& timing);
+
+    // Combinational arc, optionally gated by functional state at the edge
+    void addArc(int from, int to, const PartTiming& timing, bool invert = false,
+                Sensitize sensitize = Sensitize());
+
+    // Output enable arc, only the enabling transition of from drives new data.
+    // Disabling floats the output and the bus keeps its value, so it is not a
+    // data change for setup or hold
+    void addEnable(int from, int to, const PartTiming& timing, bool active_low = false);
+
+    // Setup/hold window on data around capture's edge
+    void addCheck(const char* name, int data, int capture, Edge_E_t edge,
+                  const PartTiming& timing);
+
+    // Call once per rising edge of the root clock with the edge time in ns,
+    // after the functional state has settled: every probe must already read
+    // the value the edge produced, or its launch lands on the next edge
+    void clockEdge(int clock, uint64_t tick_ns);
+
+    void report() const;
+
+    uint64_t setupViolations() const;
+    uint64_t holdViolations() const;
+
+    // Highest clock frequency (Hz) that meets setup on every exercised path
+    double maxSafeFrequency() const;
+
+private:
+    struct Arc
+    {
+        int to;
+        PartTiming timing;
+        bool launch;
+        bool invert;
+        int enableOn {-1};              // only propagate this source value, -1 any
+        Sensitize sensitize;
+    };
+
+    struct Signal
+    {
+        std::string name;
+        Probe probe;
+        int value {0};
+        bool changed {false};
+        std::vector<Arc> fanout;
+        std::vector<int> dataOf;        // checks where this is data
+        std::vector<int> captureOf;     // checks where this is capture
+
+        // Arrival bookkeeping for the edge currently propagating
+        uint64_t edge {UINT64_MAX};
+        uint32_t early {0};
+        uint32_t late {0};
+        bool hasEarly {false};
+        bool hasLate {false};
+    };
+
+    struct Arrival
+    {
+        uint64_t edge;
+        uint32_t delay;
+    };
+
+    struct Check
+    {
+        std::string name;
+        int data;
+        int capture;
+        Edge_E_t edge;
+        PartTiming timing;
+
+        std::vector<Arrival> pending;   // late data arrivals awaiting capture
+        Arrival dataEarly {UINT64_MAX, 0};
+        Arrival captureLate {UINT64_MAX, 0};
+
+        uint64_t captures {0};
+        uint64_t setupViolations {0};
+        uint64_t holdViolations {0};
+        double worstPeriod {0};         // ns
+        double worstSlack {0};          // ns at the simulated period
+        bool slackValid {false};
+    };
+
+    struct Event
+    {
+        int signal;
+        uint64_t edge;
+        uint32_t delay;
+        bool late;
+        bool value;
+    };
+
+    void process(const Event& ev);
+    void onData(Check& check, const Event& ev);
+    void onCapture(Check& check, const Event& ev);
+    void schedule(const Event& ev);
+
+    std::vector<Signal> m_signals;
+    std::vector<Check> m_checks;
+    TimingWheel<Event> m_wheel;
+
+    uint64_t m_edgeTick {0};
+    uint64_t m_edges {0};
+    uint64_t m_period {0};              // simulated clock period, ns
+};
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Hierarchical timing wheel
+
+    Events are keyed by an absolute 64 bit tick. Level L of the wheel holds
+    events whose tick shares every digit above L with now() but differs at
+    digit L (6 bits per digit, 64 slots per level). Insert is a single slot
+    append, and finding the next event is a bitmap scan per level with at
+    most one cascade per level, so cost per event does not grow with the
+    length of the run.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class TimingWheel
+{
+public:
+    static const int kSlotBits  = 6;
+    static const int kSlots     = 1 << kSlotBits;
+    static const int kLevels    = (64 + kSlotBits - 1) / kSlotBits;
+
+    TimingWheel() : m_now(0), m_count(0)
+    {
+        for (int l = 0; l < kLevels; l++)
+        {
+            m_occupied[l] = 0;
+        }
+    }
+
+    uint64_t now() const { return m_now; }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    // Events scheduled in the past are clamped to now()
+    void schedule(uint64_t tick, const T& payload)
+    {
+        if (tick < m_now)
+        {
+            tick = m_now;
+        }
+        insert(Entry{tick, payload});
+        m_count++;
+    }
+
+    // Pop the earliest event with tick <= limit, returns false if none
+    bool pop(uint64_t limit, uint64_t& tick, T& payload)
+    {
+        if (m_count == 0)
+        {
+            return false;
+        }
+
+        while (m_ready.empty())
+        {
+            if (!refill(limit))
+            {
+                return false;
+            }
+        }
+
+        Entry& e = m_ready[m_readyIdx++];
+        tick = e.tick;
+        payload = e.payload;
+        m_count--;
+
+        if (m_readyIdx == m_ready.size())
+        {
+            m_ready.clear();
+            m_readyIdx = 0;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        for (int l = 0; l < kLevels; l++)
+        {
+            for (int s = 0; s < kSlots; s++)
+            {
+                m_slots[l][s].clear();
+            }
+            m_occupied[l] = 0;
+        }
+        m_ready.clear();
+        m_readyIdx = 0;
+        m_count = 0;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t tick;
+        T payload;
+    };
+
+    static int digit(uint64_t tick, int level)
+    {
+        return (int)((tick >> (level * kSlotBits)) & (kSlots - 1));
+    }
+
+    static int lowestSetFrom(uint64_t bits, int from)
+    {
+        if (from >= kSlots)
+        {
+            return -1;
+        }
+        bits &= ~0ULL << from;
+        if (bits == 0)
+        {
+            return -1;
+        }
+        return __builtin_ctzll(bits);
+    }
+
+    void insert(const Entry& e)
+    {
+        uint64_t diff = e.tick ^ m_now;
+        int level = 0;
+        if (diff != 0)
+        {
+            level = (63 - __builtin_clzll(diff)) / kSlotBits;
+        }
+        int slot = digit(e.tick, level);
+        m_slots[level][slot].push_back(e);
+        m_occupied[level] |= 1ULL << slot;
+    }
+
+    // Move the next non-empty level 0 slot into the ready list, cascading
+    // higher levels down as needed. Never advances now() past limit.
+    bool refill(uint64_t limit)
+    {
+        for (int level = 0; level < kLevels; level++)
+        {
+            int from = digit(m_now, level) + (level == 0 ? 0 : 1);
+            int slot = lowestSetFrom(m_occupied[level], from);
+            if (slot < 0)
+            {
+                continue;
+            }
+
+            // Start tick of the slot, all lower digits zero
+            int shift = level * kSlotBits;
+            uint64_t span = (shift + kSlotBits >= 64) ? 0 : (~0ULL << (shift + kSlotBits));
+            uint64_t start = (m_now & span) | ((uint64_t)slot << shift);
+            if (start > limit)
+            {
+                return false;
+            }
+
+            std::vector<Entry> bucket;
+            bucket.swap(m_slots[level][slot]);
+            m_occupied[level] &= ~(1ULL << slot);
+            m_now = start;
+
+            if (level == 0)
+            {
+                m_ready.swap(bucket);
+                m_readyIdx = 0;
+                return true;
+            }
+
+            for (const Entry& e : bucket)
+            {
+                insert(e);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t m_now;
+    size_t m_count;
+    std::vector<Entry> m_slots[kLevels][kSlots];
+    uint64_t m_occupied[kLevels];
+    std::vector<Entry> m_ready;
+    size_t m_readyIdx {0};
+};
@@ -43,17 +43,39 @@
 // #define DEBUG_PRINT
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <app.hpp>
 
 using namespace DCSim;
 using namespace Componenets;
 
 // ==============================================
-// Simulation params
-const float timestep = 0.001;
-const float start_time = 0;
-const float end_time = 1;
-float time_sec;
+// Simulation params, in ticks (ps)
+const tick_t timestep = ticksFromMs(1);
+const tick_t start_time = 0;
+const tick_t end_time = ticksFromSec(1);
+tick_t time_ticks;
+bool is_setup = false;
+
+#ifdef TIMING_MODEL
+int timing_clk;
+
+// Steps after a clock edge until every probe reads the post-edge value.
+// Parts switch on the edge step, the nodes fed by them resolve on the next
+// step, and with the microcode ROMs the Control nodes one step after that
+#ifdef MICROCODE_CONTROL
+#define TIMING_SETTLE_STEPS 2
+#else
+#define TIMING_SETTLE_STEPS 1
+#endif
+
+// Edge waiting for its probes to settle
+uint64_t timing_edge_ns = 0;
+int timing_wait = 0;
+#endif
 
 // ==============================================
 // Bus components attachments
@@ -65,39 +87,174 @@ void attachComponents()
     // EEPROM and MAR
     pinGroup_t addr8 = {N_BUS_BITS, eeprom.addr_pins.pins};
     marBus.attach(addr8);
-    marBus.attach(mar.Q_pins);
     
     // main bus attach EEPROM subsys
     mainBus.attach({N_BUS_BITS, &eeprom.io_pins.pins[0]});
-    mainBus.attach(mar.D_pins);
-    
-    // PC (and PC buffer)
-    pcBus.attach(pc.Q_pins);
-    pcBus.attach(pcb.D_pins);
-    
-    // main bus attach PC subsys
-    mainBus.attach(pc.D_pins);
-    mainBus.attach(pcb.Q_pins);
-    
-    // IR (and IR Buffer)
-    irb.D_pins.num_pins = 4;
-    irb.Q_pins.num_pins = 4;
-    irBus.attach(ir.Q_pins);
-    irBus.attach(irb.D_pins);
-    
-    // main bus attach IR subsys
-    mainBus.attach(ir.D_pins);
-    mainBus.attach(irb.Q_pins);
+}
 
-    // 16 bit control bus
-    controlLBus.attach(IRDecoderL.Q_pins);
-    controlHBus.attach(IRDecoderH.Q_pins);
-    
+#ifdef TIMING_MODEL
+void setupTiming()
+{
+    // Timing points, probes sample the functional value at each clock edge
+    timing_clk      = timing.addSignal("CLK");
+    int rc1         = timing.addSignal("RC1", []{ return (int)RC1_Node.get_value(); });
+    int rc2         = timing.addSignal("RC2", []{ return (int)RC2_Node.get_value(); });
+    int rc3         = timing.addSignal("RC3", []{ return (int)RC3_Node.get_value(); });
+    int pc_q        = timing.addSignal("PC.Q", []{ return (int)pc.get_value(); });
+    int pcb_q       = timing.addSignal("PCB.Q");
+    int mar_q       = timing.addSignal("MAR.Q");
+    int not_oe      = timing.addSignal("EEPROM.OE");
+    int mem_data    = timing.addSignal("EEPROM.IO");
+
+    // Clock to output
+    timing.addLaunch(timing_clk, rc1, Datasheet::HC164_Ring);
+    timing.addLaunch(timing_clk, rc2, Datasheet::HC164_Ring);
+    timing.addLaunch(timing_clk, rc3, Datasheet::HC164_Ring);
+    timing.addLaunch(timing_clk, pc_q, Datasheet::HC161_Counter);
+
+    // Fetch control lines, straight from the ring counter or through the microcode ROM
+    #ifdef MICROCODE_CONTROL
+    auto control = [](uint32_t ctrl){ return [ctrl]{ return (int)Control[ctrlBit(ctrl)].get_value(); }; };
+    int pe = timing.addSignal("UCODE.PC_Out", control(kCtrlPcOut));
+    int lm = timing.addSignal("UCODE.MAR_Load", control(kCtrlMarLoad));
+    int cp = timing.addSignal("UCODE.PC_Count", control(kCtrlPcCount));
+    int me = timing.addSignal("UCODE.Mem_Out", control(kCtrlMemOut));
+    int li = timing.addSignal("UCODE.IR_Load", control(kCtrlIrLoad));
+    timing.addArc(rc1, pe, Datasheet::AT28C64_tACC);
+    timing.addArc(rc1, lm, Datasheet::AT28C64_tACC);
+    timing.addArc(rc2, cp, Datasheet::AT28C64_tACC);
+    timing.addArc(rc3, me, Datasheet::AT28C64_tACC);
+    timing.addArc(rc3, li, Datasheet::AT28C64_tACC);
+    auto pe_high = []{ return Control[ctrlBit(kCtrlPcOut)].get_value() == kLogicHigh; };
+    auto lm_high = []{ return Control[ctrlBit(kCtrlMarLoad)].get_value() == kLogicHigh; };
+    #else
+    int pe = rc1;
+    int lm = rc1;
+    int cp = rc2;
+    int me = rc3;
+    int li = rc3;
+    auto pe_high = []{ return RC1_Node.get_value() == kLogicHigh; };
+    auto lm_high = pe_high;
+    #endif
+
+    // Fetch: PC -> PCB -> mainBus -> MAR -> marBus -> EEPROM address
+    timing.addEnable(pe, pcb_q, Datasheet::HC245_Enable);
+    timing.addArc(pc_q, pcb_q, Datasheet::HC245_Buffer, false, pe_high);
+    timing.addArc(lm, mar_q, Datasheet::HC573_Latch);
+    timing.addArc(pcb_q, mar_q, Datasheet::HC573_Latch, false, lm_high);
+    timing.addArc(mar_q, mem_data, Datasheet::AT28C64_tACC);
+
+    // ME -> Not_OE -> eeprom.OutputEnable -> mainBus
+    timing.addArc(me, not_oe, Datasheet::HC04_Not, true);
+    // OE low drives data (tOE), OE high only floats the bus (tDF) and is not a data change
+    timing.addEnable(not_oe, mem_data, Datasheet::AT28C64_tOE, true);
+
+    // Capture points
+    timing.addCheck("IR.D <- LI", mem_data, li, TimingModel::kFallingEdge, Datasheet::HC573_Latch);
+    timing.addCheck("MAR.D <- LM", pcb_q, lm, TimingModel::kFallingEdge, Datasheet::HC573_Latch);
+    timing.addCheck("PC.ENP <- CLK", cp, timing_clk, TimingModel::kRisingEdge, Datasheet::HC161_Counter);
 }
+#endif
+
+#ifdef ACTIVITY_STATS
+void setupActivity()
+{
+    // Nodes
+    activity.addSignal("CLK", 1, []{ return (uint32_t)(CLK_Node.get_value() == kLogicHigh); });
+    activity.addSignal("RC1", 1, []{ return (uint32_t)(RC1_Node.get_value() == kLogicHigh); });
+    activity.addSignal("RC2", 1, []{ return (uint32_t)(RC2_Node.get_value() == kLogicHigh); });
+    activity.addSignal("RC3", 1, []{ return (uint32_t)(RC3_Node.get_value() == kLogicHigh); });
+    activity.addSignal("RC4", 1, []{ return (uint32_t)(RC4_Node.get_value() == kLogicHigh); });
+    activity.addSignal("RC5", 1, []{ return (uint32_t)(RC5_Node.get_value() == kLogicHigh); });
+    activity.addSignal("NME", 1, []{ return (uint32_t)(NME_node.get_value() == kLogicHigh); });
+    activity.addSignal("NOPC4", 1, []{ return (uint32_t)(NOPC4.get_value() == kLogicHigh); });
+    activity.addSignal("OPCode", 4, []
+    {
+        uint32_t op = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            op |= (uint32_t)(OPCode[i].get_value() == kLogicHigh) << i;
+        }
+        return op;
+    });
+
+    // Buses
+    activity.addSignal("mainBus", 8, []{ return (uint32_t)mainBus.get_value().byte; });
+    activity.addSignal("marBus", 8, []{ return (uint32_t)marBus.get_value().byte; });
+    activity.addSignal("pcBus", 8, []{ return (uint32_t)pcBus.get_value().byte; });
+    activity.addSignal("irBus", 8, []{ return (uint32_t)irBus.get_value().byte; });
+    activity.addSignal("controlLBus", 8, []{ return (uint32_t)controlLBus.get_value().byte; });
+    activity.addSignal("controlHBus", 8, []{ return (uint32_t)controlHBus.get_value().byte; });
+
+    #ifdef MICROCODE_CONTROL
+    activity.addSignal("Control", MICROCODE_BITS, []
+    {
+        uint32_t word = 0;
+        for (int i = 0; i < MICROCODE_BITS; i++)
+        {
+            word |= (uint32_t)(Control[i].get_value() == kLogicHigh) << i;
+        }
+        return word;
+    });
+    #endif
+}
+
+void writeActivity()
+{
+    FILE* csv = fopen(ACTIVITY_CSV, "w");
+    if (csv)
+    {
+        activity.writeCsv(csv, kSap2Mnemonics);
+        fclose(csv);
+    }
+
+    FILE* json = fopen(ACTIVITY_JSON, "w");
+    if (json)
+    {
+        activity.writeJson(json, kSap2Mnemonics);
+        fclose(json);
+    }
+    printf("Activity: %s, %s\n", ACTIVITY_CSV, ACTIVITY_JSON);
+}
+#endif
+
+#ifdef STATE_HASH
+void hashState()
+{
+    core0.hashState(stateHash);
+    stateHash.add(outReg.get_value());
+    stateHash.commit();
+}
+#endif
+
+#ifdef ELABORATE_NETLIST
+void elaborateNetlist()
+{
+    // Graph from the real wiring, memory is owned here
+    Elaborator elab;
+    core0.describe(elab);
+    Sap2Core::describeMemory(elab, eeprom, "eeprom");
+
+    elab.elaborate();
+    elab.prune(nodes, parts);
+    elab.trackDrivers(lazyDrivers);
+    elab.report();
+}
+#endif
 
 void setup() 
 {
+    if (is_setup)
+    {
+        return;
+    }
+    is_setup = true;
+
+    parts.insert(parts.begin(), &eeprom);
+
     // One time setup
+    core0.wire();
+    core0.trackGroups(lazyDrivers);
     attachComponents();
 
     // Print Buses
@@ -116,13 +273,8 @@ void setup()
     printf("clk ID : %d \n", clk.get_uuid());
     
     // ==========================
-    // GND and VCC Connections
-    ground_node.connect(&GND);
-    source_node.connect(&Source);
-
     // EEprom control nodes
     NME_node.connect(&eeprom.OutputEnable);
-    NME_node.connect(&Not_OE.Out1);
 
     // Disable address bits 8->12
     for (int i = eeprom.io_pins.num_pins; i < eeprom.addr_pins.num_pins; i++) 
@@ -130,232 +282,26 @@ void setup()
         ground_node.connect(&eeprom.addr_pins.pins[i]);
     }
     
-    // EEPROM NWE pin connect to node, ground in put to not gate
+    // EEPROM NWE pin connect to node
     NWE_node.connect(&eeprom.WriteEnable);
-    NWE_node.connect(&Not_WE.Out1);
-    ground_node.connect(&Not_WE.In1);
     
     // EEProm Chip enable LOW
     ground_node.connect(&eeprom.ChipEnable);
 
-    // Connect MAR Latch
-    source_node.connect(&mar.OutputEnable);
-    
-    // Clock enable
-    clk.set_frequency(100.0);
-    source_node.connect(&clk.Enable);
-    
-    // unclear counters
-    source_node.connect(&rc.Clear);
-    source_node.connect(&pc.Clear);
-
-    // disable laod for now
-    source_node.connect(&pc.Load);
+    // Clock
+    tickClock.set_frequency(100);
 
-    // PC setup
-    source_node.connect(&pc.OutputEnable);
-
-    // IR setup
-    source_node.connect(&ir.OutputEnable);
-    #ifdef DISABLE_IR_OUT
-    ground_node.connect(&irb.OutputEnable);
+    #ifdef ELABORATE_NETLIST
+    elaborateNetlist();
     #endif
-    
-    // Connect clock to ring counter
-    CLK_Node.connect(&clk.Clk);
-    CLK_Node.connect(&rc.Clock);
-    CLK_Node.connect(&pc.Clock);
-    
-    // Connect ring counter to 
-    RC1_Node.connect(&rc.Q_pins.pins[0]);
-    RC2_Node.connect(&rc.Q_pins.pins[1]);
-    RC3_Node.connect(&rc.Q_pins.pins[2]);
-    RC4_Node.connect(&rc.Q_pins.pins[3]);
-    RC5_Node.connect(&rc.Q_pins.pins[4]);
-
-    //============================================================//
-    /*
-    op    Seq     Control
-    4  ->  16  ->  20
-    LA 4OR LDA, ADD, LDM
-
-    LDA
-    IE, LM | ME, LA
-
-    LDB
-    IE, LM | ME, LB
-
-    STR
-    IE, LM, | AE, WE
-
-    ADD (SUB)
-    (SU)
-    LF | UE, LA
-
-    CLR
-    | <LA; LB; LO; LP; LM; LF;> 
-
-    OUT
-    | AE, LO
-
-    LDM
-    AE, LM | ME, LA
-
-    AO, LP?
-    JPZ
-    Z !
-    EI, LM | ME, LP
-
-    JPC
-    C !
-    EI, LM | ME, LP
-
-    JMP
-    EI, LM | ME, LP
-
-    STM
-    AE, LM | UE, WE
-
-    MOV
-    | AE, LB
-
-    */
-
-    //============================================================//
-    /*
-    -> 4 bit op code           
-        (IR[4:]) 
-        0  |  2^0 (1)
-        1  |  2^1 (2)
-        2  |  2^2 (4)
-        3  |  2^4 (8)
-    */
-    // Connect Op decoder to high 4 bits of IR
-    for (int i = 0;i < 4;i++) 
-    {
-        OPCode[i].connect(&ir.Q_pins.pins[i+4]);
-    }
-
-    //============================================================//
-
-    /*
-    -> 16 bit Instruction bus
-        ( 2 x Decoder3to8 ) decodes to 16 channels
-        0  |  NOP
-        1  |  LDI
-        2  |  LDA
-        3  |  LDB 
-        4  |  JMP
-        5  |  JPZ
-        6  |  JPC
-        7  |  STR
-        8  |  LDM
-        9  |  MOV
-        10 |  OUT
-        11 |  STM
-        12 |  ADD
-        13 |  SUB
-        14 |  SFT
-        15 |  HLT
-
-         instruction decoder     ( OR gates )
-    */
-
-    // Connect OPCode to the decoders
-    for (int i = 0;i < 3;i++) 
-    {
-        OPCode[i].connect(&IRDecoderL.D_pins.pins[i]);
-        OPCode[i].connect(&IRDecoderH.D_pins.pins[i]);
-    }
-    
-    // Op code high bit should be tied to both deoceders enable, IRL_OE = ! Opcode[3]
-    OPCode[3].connect(&Not_IRLe.In1);
-    OPCode[3].connect(&IRDecoderH.OutputEnable);
-    
-    NOPC4.connect(&Not_IRLe.Out1);
-    NOPC4.connect(&IRDecoderL.OutputEnable);
-    
-
-
 
+    #ifdef TIMING_MODEL
+    setupTiming();
+    #endif
 
-    
-    //============================================================//
-    /*
-    -> 16 bit Sequencer
-        ( 2 x Buffers )
-        Buffer1 - Sequence RC4 : Instruction Execute 1
-            0  |  EI_1
-            1  |  LM_1
-            2  |  LA_1
-            3  |  LB_1
-            4  |  AE_1
-            5  |  LS_1
-            6  |  LO_1
-            7  |  SE_1
-        Buffer2 - Sequence RC5 : Instruction Execute 2
-            0  |  ME_2
-            1  |  LA_2
-            2  |  UE_2
-            3  |  LP_2
-            4  |  WE_2
-            5  |  ---
-            6  |  ---
-            7  |  ---
-
-        sequence decoder
-            ( OR gates )
-    */
-    // Sequencing buffers for instructions
-    RC4_Node.connect(&Seq1Buffer.OutputEnable);
-    RC5_Node.connect(&Seq2Buffer.OutputEnable);
-
-
-
-
-
-
-
-    //============================================================//
-    /*
-    -> 20 bit Control output Bus      (8 Fixed control) + (12 bit Sequenced control)
-
-        // Fixed Sequence Outs (Fetch & Modify)
-        0 |  PC_Out              // Fetch Outputs
-        1 |  PC_Count
-        2 |  IR_Load
-        -----------------------
-        3 |  StoreMem           // Instruction Modify outputs
-        4 |  Subtract            
-        5 |  JumpZero
-        6 |  JumpCarry
-        7 |  HALT
-
-        // Buffered Outs (Execute)
-        0  |  MAR_Load
-        1  |  B_Load
-        2  |  Status_Load
-        3  |  Out_Load
-        4  |  IR_Out
-        5  |  A_Out
-        6  |  Shift_Out
-        7  |  A_Load
-        ------------
-        8  |  Mem_Out
-        9  |  Alu_Out
-        10 |  PC_Load
-        11 |  Mem_Load
-    */
-
-    // Connect control to ring counter
-    // Fixed Instruction is Fetch
-    RC1_Node.connect(&pcb.OutputEnable);
-    RC1_Node.connect(&mar.LatchEnable); // add to OR Gate
-    RC2_Node.connect(&pc.Count);
-    RC3_Node.connect(&Not_OE.In1);      // Add to OR Gate
-    RC3_Node.connect(&ir.LatchEnable);
-
-    
+    #ifdef ACTIVITY_STATS
+    setupActivity();
+    #endif
 
     // Print info for init
     printf("VCC   PinID: %d \t| PinState   : %d\n", Source.get_id(), Source.get_state());
@@ -370,7 +316,8 @@ void debugPrint ()
     // printf("RC4: %d |\t", RC4_Node.get_value());
     // printf("RC5: %d |\t", RC5_Node.get_value());
     
-    printf("T: %5.2f |\t C: %3d |\t", time_sec, clk.Clk.get_value());
+    printf("T: %2llu.%02llu |\t C: %3d |\t", (unsigned long long)(time_ticks / kTicksPerSec),
+           (unsigned long long)((time_ticks % kTicksPerSec) / (kTicksPerSec / 100)), clk.Clk.get_value());
     printf("Bus: %3d |\t", mainBus.get_value().byte);
     printf("PC: %3d |\t", pc.get_value());
 
@@ -388,8 +335,12 @@ void debugPrint ()
     printf("Op:  0b%1d%1d%1d%1d |\t",(bool)OPCode[3].get_value(), (bool)OPCode[2].get_value(), (bool)OPCode[1].get_value(), (bool)OPCode[0].get_value());
     printf("CT:  0x%02x%02x |\t", (uint8_t)controlHBus.get_value().byte, (uint8_t)controlLBus.get_value().byte );
     
-    printf ("IRDLO: %2d |\t", getPinGroup(IRDecoderL.Q_pins));
-    printf ("IRDHO: %2d |\t", getPinGroup(IRDecoderH.Q_pins));
+    printf ("IRDLO: %2d |\t", IRDecoderL_Q.get());
+    printf ("IRDHO: %2d |\t", IRDecoderH_Q.get());
+
+    #ifdef MICROCODE_CONTROL
+    printf("CW:  0x%05x |\t", UCode_Q[0].get() | (UCode_Q[1].get() << 8) | ((UCode_Q[2].get() & 0x0F) << 16));
+    #endif
 
     // printf ("RC4 : %d |\t", (bool)OPCode[3].get_value());
     // printf ("NRC4: %d |\t", NOPC4.get_value());
@@ -397,79 +348,534 @@ void debugPrint ()
 }
 
 
-void run () 
+// ==============================================
+// Stepping, shared by run() and SimControl.hpp
+
+bool clock_high = false;
+bool sim_verbose = true;
+uint64_t step_count = 0;
+uint64_t cycle_count = 0;
+
+bool simStep()
 {
-    printf(" = = = 8SAP1 = = = \n");
+    LazyPinGroup::advanceEpoch();
+
+    // set clock
+    clk.Clk.set_value((clk.Enable.get_value() == kLogicHigh) && tickClock.level(time_ticks) ? kLogicHigh : kLogicLow);
+
+    // Mark the nodes whose drivers changed since the last pass
+    lazyDrivers.update();
     
-    time_sec = start_time;
-    int const n_steps = (end_time - start_time)/timestep + 1;
-    printf("timesteps: %d \n", n_steps);
+    // Evaluate Nodes
+    for (LazyNode* node : nodes) 
+    {
+        node->evaluate();
+    }
     
-    bool clock = false;
+    // Evaluate Components
+    for (Component* part : parts) 
+    {
+        //printf("p: %0lx\n", (uint64_t)part);
+        part->evaluate();
+    }
     
-    // Initialize logs
-    float time_sig[n_steps] = {0};
-    bool clk_sig[n_steps] = {0};
-    bool rc1_sig[n_steps] = {0};
-    bool rc2_sig[n_steps] = {0};
-    bool rc3_sig[n_steps] = {0};
-    bool rc4_sig[n_steps] = {0};
-    bool rc5_sig[n_steps] = {0};
+    // Evaluate Buses
+    for (Bus8bit* bus : buses)
+    {
+        bus->evaluate();
+    }
+
+    // Pin groups whose parts changed them this step
+    lazyDrivers.updateGroups();
+    
+    #ifdef ACTIVITY_STATS
+    activity.sample((ir.getLatchValue() >> 4) & 0x0F);
+    #endif
+
+    #ifdef TIMING_MODEL
+    // The last edge has settled, the model samples its probes now
+    if ((timing_wait > 0) && (--timing_wait == 0))
+    {
+        timing.clockEdge(timing_clk, timing_edge_ns);
+    }
+    #endif
+
+    // Evaluate Clock
+    bool edge = false;
+    if ( (step_count == 0) || (!clock_high && (clk.Clk.get_value() == kLogicHigh)) ) 
+    {
+        #ifdef TIMING_MODEL
+        timing_edge_ns = ticksToNs(time_ticks);
+        timing_wait = TIMING_SETTLE_STEPS;
+        #endif
+
+        outReg.sampleBus(mainBus.get_value().byte, core0.outLoad(), cycle_count);
+        cycle_count++;
+
+        #ifdef STATE_HASH
+        hashState();
+        #endif
+
+        if (sim_verbose)
+        {
+            debugPrint ();
+            printf ("\n");
+        }
+        clock_high = (bool)kLogicHigh;
+        edge = true;
+    }
+    
+    if ( clock_high && (clk.Clk.get_value() == kLogicLow) ) 
+    {
+        clock_high = (bool)kLogicLow;
+    }
+    
+    // Logging dump, only when tracing was asked for
+    if (trace.enabled())
+    {
+        const uint8_t rc[SIM_RC_SIGNALS] = {
+            (uint8_t)RC1_Node.get_value(), (uint8_t)RC2_Node.get_value(), (uint8_t)RC3_Node.get_value(),
+            (uint8_t)RC4_Node.get_value(), (uint8_t)RC5_Node.get_value()
+        };
+        trace.push(time_ticks, (uint8_t)clk.Clk.get_value(), rc);
+    }
+            
+    time_ticks += timestep;
+    step_count++;
+    return edge;
+}
+
+void run () 
+{
+    printf(" = = = 8SAP1 = = = \n");
+    
+    time_ticks = start_time;
+    uint64_t const n_steps = (end_time - start_time)/timestep + 1;
+    printf("timesteps: %llu |\t period: %llu ps\n", (unsigned long long)n_steps, (unsigned long long)tickClock.period());
 
     // TODO : - FIX this! its crashig the progam
-    eeprom.loadProgram((uint8_t*)test_program_01, PROGRAM_SZIE);
-
-    for (int i = 0; i < n_steps; i++) 
-    {
-    //    printf("\n");
-        // printf ("Timestep: %d |\t", i);
-        
-        // record time and set clock
-        time_sig[i] = time_sec;
-        clk.set_time(time_sec);
-        
-        // Evaluate Nodes
-        for (ElectricalNode* node : nodes) 
+    loadProgram((uint8_t*)test_program_01, PROGRAM_SZIE);
+
+    // Program output, drained on its own thread
+    FILE* out_file = fopen(OUT_FILE, "w");
+    outStream.toFile(out_file);
+    outStream.start();
+
+    for (uint64_t i = 0; i < n_steps; i++) 
+    {
+        simStep();
+
+        #ifdef STATE_HASH
+        // Nothing after the first divergent checkpoint is worth simulating
+        if (stateHash.diverged())
+        {
+            break;
+        }
+        #endif
+    }
+
+    outStream.stop();
+    outStream.toFile(nullptr);
+    if (out_file)
+    {
+        fclose(out_file);
+    }
+    printf("Output records: %llu -> %s\n", (unsigned long long)outStream.consumed(), OUT_FILE);
+
+    #ifdef STATE_HASH
+    // A failed regression writes no reports, main() exits non-zero
+    if (stateHash.diverged())
+    {
+        return;
+    }
+    #endif
+
+    #ifdef TIMING_MODEL
+    timing.report();
+    #endif
+
+    #ifdef ACTIVITY_STATS
+    writeActivity();
+    #endif
+
+    #ifdef STATE_HASH
+    // Golden runs only compare, the golden file is never rewritten
+    if (!stateHash.checking())
+    {
+        stateHash.save(HASH_FILE);
+    }
+    #endif
+
+    #ifdef LAZY_STATS
+    LazyNode::report();
+    #endif
+}
+
+// ==============================================
+// Scripted access, see SimControl.hpp
+
+struct NamedNode
+{
+    const char* name;
+    LazyNode* node;
+};
+
+static const NamedNode named_nodes[] = {
+    {"ground_node", &ground_node},
+    {"source_node", &source_node},
+    {"ME_node", &ME_node},
+    {"WE_node", &WE_node},
+    {"MCE_node", &MCE_node},
+    {"LM_Node", &LM_Node},
+    {"CP_Node", &CP_Node},
+    {"LP_Node", &LP_Node},
+    {"PE_Node", &PE_Node},
+    {"LI_Node", &LI_Node},
+    {"IE_Node", &IE_Node},
+    {"CLK_Node", &CLK_Node},
+    {"RC1_Node", &RC1_Node},
+    {"RC2_Node", &RC2_Node},
+    {"RC3_Node", &RC3_Node},
+    {"RC4_Node", &RC4_Node},
+    {"RC5_Node", &RC5_Node},
+    {"OPCode[0]", &OPCode[0]},
+    {"OPCode[1]", &OPCode[1]},
+    {"OPCode[2]", &OPCode[2]},
+    {"OPCode[3]", &OPCode[3]},
+    {"NOPC4", &NOPC4},
+    {"NME_node", &NME_node},
+    {"NWE_node", &NWE_node}
+};
+
+static const char* const bus_names[] = {
+    "mainBus", "marBus", "pcBus", "irBus", "controlLBus", "controlHBus"
+};
+
+static std::vector<OutputRecord> captured_outputs;
+
+bool isSetup()
+{
+    return is_setup;
+}
+
+void loadProgram(const uint8_t* program, size_t size)
+{
+    if (size > SIM_EEPROM_SIZE)
+    {
+        size = SIM_EEPROM_SIZE;
+    }
+    // program may be the image itself, reloaded after edits
+    memmove(program_image, program, size);
+    memset(program_image + size, 0, sizeof(program_image) - size);
+    eeprom.loadProgram(program_image, (int)size);
+}
+
+uint8_t* programImage()
+{
+    return program_image;
+}
+
+uint8_t* microcodeImage(int lane)
+{
+    #ifdef MICROCODE_CONTROL
+    if ((lane >= 0) && (lane < MICROCODE_LANES))
+    {
+        return microcode.image(lane);
+    }
+    #endif
+    return nullptr;
+}
+
+void simVerbose(bool verbose)
+{
+    sim_verbose = verbose;
+}
+
+tick_t simTime()
+{
+    return time_ticks;
+}
+
+tick_t simTimestep()
+{
+    return timestep;
+}
+
+tick_t simPeriod()
+{
+    return tickClock.period();
+}
+
+uint64_t simSteps()
+{
+    return step_count;
+}
+
+uint64_t simCycles()
+{
+    return cycle_count;
+}
+
+int readNode(const char* name)
+{
+    for (const NamedNode& n : named_nodes)
+    {
+        if (strcmp(n.name, name) == 0)
         {
-            node->evaluate();
+            return n.node->get_value() == kLogicHigh;
         }
-        
-        // Evaluate Components
-        for (Component* part : parts) 
+    }
+    #ifdef MICROCODE_CONTROL
+    for (int i = 0; i < MICROCODE_BITS; i++)
+    {
+        if (strcmp(kCtrlNames[i], name) == 0)
         {
-            //printf("p: %0lx\n", (uint64_t)part);
-            part->evaluate();
+            return Control[i].get_value() == kLogicHigh;
         }
-        
-        // Evaluate Buses
-        for (Bus8bit* bus : buses)
+    }
+    #endif
+    return -1;
+}
+
+int readBus(const char* name)
+{
+    for (size_t i = 0; i < buses.size(); i++)
+    {
+        if (strcmp(bus_names[i], name) == 0)
         {
-            bus->evaluate();
+            return buses[i]->get_value().byte;
         }
-        
-        // Evaluate Clock
-        if ( (i==0) || (!clock && (clk.Clk.get_value() == kLogicHigh)) ) 
+    }
+    return -1;
+}
+
+std::vector<const char*> nodeNames()
+{
+    std::vector<const char*> names;
+    for (const NamedNode& n : named_nodes)
+    {
+        names.push_back(n.name);
+    }
+    #ifdef MICROCODE_CONTROL
+    for (int i = 0; i < MICROCODE_BITS; i++)
+    {
+        names.push_back(kCtrlNames[i]);
+    }
+    #endif
+    return names;
+}
+
+std::vector<const char*> busNames()
+{
+    return std::vector<const char*>(bus_names, bus_names + buses.size());
+}
+
+int readPc()
+{
+    return pc.get_value();
+}
+
+int readMar()
+{
+    return (uint8_t)mar.getLatchValue();
+}
+
+int readIr()
+{
+    return (uint8_t)ir.getLatchValue();
+}
+
+int readOut()
+{
+    return outReg.get_value();
+}
+
+uint32_t readControlWord()
+{
+    #ifdef MICROCODE_CONTROL
+    uint32_t word = 0;
+    for (int i = 0; i < MICROCODE_BITS; i++)
+    {
+        word |= (uint32_t)(Control[i].get_value() == kLogicHigh) << i;
+    }
+    return word;
+    #else
+    return (uint32_t)controlLBus.get_value().byte | ((uint32_t)controlHBus.get_value().byte << 8);
+    #endif
+}
+
+SignalTrace& signalTrace()
+{
+    return trace;
+}
+
+void captureOutputs()
+{
+    outStream.toCallback([](const OutputRecord* records, size_t count)
+    {
+        captured_outputs.insert(captured_outputs.end(), records, records + count);
+    });
+}
+
+std::vector<OutputRecord> takeOutputs()
+{
+    outStream.drain();
+    std::vector<OutputRecord> records;
+    records.swap(captured_outputs);
+    return records;
+}
+
+// ==============================================
+// Behavioral CPU (instruction level, block cache)
+
+void runBehavioral(uint64_t n_instr)
+{
+    printf(" = = = 8SAP2 Behavioral = = = \n");
+
+    Sap2Cpu cpu;
+    cpu.loadProgram((uint8_t*)test_program_01, PROGRAM_SZIE);
+    Sap2BlockCache cache(cpu);
+
+    // OUT goes to the output register, streamed in batches
+    FILE* out_file = fopen(OUT_FILE, "w");
+    outStream.toFile(out_file);
+    outStream.start();
+    cpu.outPort = &outReg;
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t retired = cache.run(n_instr);
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    outStream.stop();
+    outStream.toFile(nullptr);
+    if (out_file)
+    {
+        fclose(out_file);
+    }
+
+    const Sap2State_t& s = cpu.state;
+    printf("Instr: %llu |\t Cycles: %llu |\t Time: %.3f ms |\t Halted: %d\n",
+           (unsigned long long)retired, (unsigned long long)s.cycles, ms, s.halted);
+    printf("A: %3d |\t B: %3d |\t PC: %3d |\t Mar: %3d |\t Ir: 0x%02x |\t Out: %3d |\t Z: %d C: %d\n",
+           s.a, s.b, s.pc, s.mar, s.ir, s.out, s.zero, s.carry);
+    printf("Blocks: %llu |\t Translations: %llu |\t Invalidations: %llu |\t Fused: %llu\n",
+           (unsigned long long)cache.blocksExecuted, (unsigned long long)cache.translations,
+           (unsigned long long)cache.invalidations, (unsigned long long)cache.fusedPairs);
+    printf("Output records: %llu in %llu batches -> %s\n", (unsigned long long)outStream.consumed(),
+           (unsigned long long)outStream.batches(), OUT_FILE);
+}
+
+// ==============================================
+// Shared memory system against the single core circuit
+
+// Per-cycle state hashes and OUT writes of one core, as hashState() and
+// outReg see them
+struct CoreTrace
+{
+    StateHash hash;
+    std::vector<uint64_t> hashes;
+    std::vector<OutputRecord> outs;
+    uint8_t out {0};
+
+    void cycle(Sap2Core& core, uint8_t port)
+    {
+        if (core.outLoad())
         {
-            debugPrint ();
-            printf ("\n");
-            clock = (bool)kLogicHigh;
+            out = core.mainBus.get_value().byte;
+            outs.push_back(OutputRecord{hashes.size(), port, out});
+        }
+        core.hashState(hash);
+        hash.add(out);
+        hashes.push_back(hash.commit());
+    }
+};
+
+// Every core must pass through the reference's states and OUT writes cycle
+// for cycle, arbitration only delays it. One core must not stall at all
+int checkMulticore(int n_cores, uint64_t n_steps)
+{
+    printf(" = = = 8SAP2 Multicore Check (%d cores) = = = \n", n_cores);
+
+    simVerbose(false);
+    setup();
+    loadProgram((uint8_t*)test_program_01, PROGRAM_SZIE);
+
+    CoreTrace ref;
+    for (uint64_t i = 0; i < n_steps; i++)
+    {
+        if (simStep())
+        {
+            ref.cycle(core0, 0);
+        }
+    }
+
+    int failures = 0;
+    #ifdef STATE_HASH
+    // The reference trace is the app's own stream
+    if (ref.hash.rolling() != stateHash.rolling())
+    {
+        printf("FAIL reference |\t trace %016llx |\t app %016llx\n",
+               (unsigned long long)ref.hash.rolling(), (unsigned long long)stateHash.rolling());
+        failures++;
+    }
+    #endif
+
+    Sap2System sys(n_cores);
+    sys.loadProgram((uint8_t*)test_program_01, PROGRAM_SZIE);
+    std::vector<CoreTrace> traces(n_cores);
+    sys.onCycle([&](int i) { traces[i].cycle(sys.core(i), (uint8_t)i); });
+
+    // Stalled cores fall behind, n cores get up to n times the steps
+    size_t cycles = ref.hashes.size();
+    for (uint64_t i = 0; i < n_steps * n_cores; i++)
+    {
+        bool done = true;
+        for (const CoreTrace& t : traces)
+        {
+            done = done && (t.hashes.size() >= cycles);
+        }
+        if (done)
+        {
+            break;
+        }
+        sys.step();
+    }
+
+    for (int i = 0; i < n_cores; i++)
+    {
+        const CoreTrace& t = traces[i];
+        size_t n = std::min(t.hashes.size(), cycles);
+        size_t diverged = std::mismatch(ref.hashes.begin(), ref.hashes.begin() + n, t.hashes.begin()).first - ref.hashes.begin();
+
+        size_t outs = 0;
+        bool outs_ok = true;
+        for (const OutputRecord& r : t.outs)
+        {
+            if (r.cycle >= cycles)
+            {
+                break;
+            }
+            outs_ok = outs_ok && (outs < ref.outs.size()) &&
+                      (r.cycle == ref.outs[outs].cycle) && (r.value == ref.outs[outs].value);
+            outs++;
         }
-        
-        if ( clock && (clk.Clk.get_value() == kLogicLow) ) 
+        outs_ok = outs_ok && (outs == ref.outs.size());
+
+        bool ok = (n == cycles) && (diverged == n) && outs_ok;
+        printf("Core %2d | Cycles: %6zu / %zu |\t Stalled: %6llu |\t Outputs: %4zu / %zu |\t %s",
+               i, t.hashes.size(), cycles, (unsigned long long)sys.stallCycles(i), outs, ref.outs.size(), ok ? "ok" : "FAIL");
+        if (diverged < n)
         {
-            clock = (bool)kLogicLow;
+            printf(" at cycle %zu", diverged);
         }
-        
-        // Logging dump
-        clk_sig[i] = clk.Clk.get_value();
-        rc1_sig[i] = RC1_Node.get_value();
-        rc2_sig[i] = RC2_Node.get_value();
-        rc3_sig[i] = RC3_Node.get_value();
-        rc4_sig[i] = RC4_Node.get_value();
-        rc5_sig[i] = RC5_Node.get_value();
-                
-        time_sec += timestep;
+        printf("\n");
+        failures += !ok;
     }
+    sys.report();
+
+    printf("Multicore check |\t Failures: %d\n", failures);
+    return failures ? 1 : 0;
 }
 
 int main(int argc, char** argv)
@@ -478,11 +884,82 @@ int main(int argc, char** argv)
     #ifdef TEST_BENCH
     sim_test(argc, (char**)argv);
     #else
+    // Instruction level run: 8SAP.exe --behavioral [n_instructions]
+    if ((argc > 1) && (strcmp(argv[1], "--behavioral") == 0))
+    {
+        uint64_t n_instr = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 1000000;
+        runBehavioral(n_instr);
+        return 0;
+    }
+
+    // Shared memory correctness: 8SAP.exe --multicore-check [n_cores] [n_steps]
+    if ((argc > 1) && (strcmp(argv[1], "--multicore-check") == 0))
+    {
+        int n_cores = (argc > 2) ? atoi(argv[2]) : 4;
+        uint64_t n_steps = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 1001;
+        return checkMulticore((n_cores > 0) ? n_cores : 1, n_steps);
+    }
+
+    // Shared memory scaling: 8SAP.exe --multicore [max_cores] [n_steps]
+    if ((argc > 1) && (strcmp(argv[1], "--multicore") == 0))
+    {
+        int max_cores = (argc > 2) ? atoi(argv[2]) : 8;
+        uint64_t n_steps = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 1001;
+        runScaling((uint8_t*)test_program_01, PROGRAM_SZIE, (max_cores > 0) ? max_cores : 1, n_steps);
+        return 0;
+    }
+
+    #ifdef MICROCODE_CONTROL
+    // Write the microcode ROM images: 8SAP.exe --microcode [prefix]
+    if ((argc > 1) && (strcmp(argv[1], "--microcode") == 0))
+    {
+        for (int op = 0; op < 16; op++)
+        {
+            microcode.print(op);
+        }
+        return microcode.save((argc > 2) ? argv[2] : "8SAP_ucode") ? 0 : 1;
+    }
+    #endif
+
+    #ifdef STATE_HASH
+    // Regression: 8SAP.exe [--hash-stride <cycles>] [--golden <hash_file>]
+    const char* golden = nullptr;
+    uint32_t stride = 0;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--golden") == 0)
+        {
+            golden = argv[++i];
+        }
+        else if (strcmp(argv[i], "--hash-stride") == 0)
+        {
+            stride = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            if (stride == 0)
+            {
+                printf("--hash-stride needs a cycle count > 0\n");
+                return 1;
+            }
+            stateHash.setStride(stride);
+        }
+    }
+    if (golden && !stateHash.loadGolden(golden, stride))
+    {
+        return 1;
+    }
+    #endif
+
     // Setup routine
     setup();
     
     // Run simulation
     run();
+
+    #ifdef STATE_HASH
+    if (!stateHash.report())
+    {
+        return 1;
+    }
+    #endif
     #endif
     
     return 0;
@@ -22,7 +22,23 @@
 
 #include <program.h>
 
-#define DISABLE_IR_OUT
+#include <TimingModel.hpp>
+#include <Sap2BlockCache.hpp>
+#include <Peripheral.hpp>
+#include <Elaborator.hpp>
+#include <ActivityMonitor.hpp>
+#include <StateHash.hpp>
+#include <LazyNode.hpp>
+#include <Timebase.hpp>
+#include <MicrocodeRom.hpp>
+#include <SimControl.hpp>
+#include <Sap2Core.hpp>
+#include <Sap2System.hpp>
+
+#define TIMING_MODEL
+#define ELABORATE_NETLIST
+#define ACTIVITY_STATS
+#define STATE_HASH
 
 // #define MAIN_BUS_ID 250
 // #define MAR_BUS_ID  259
@@ -36,6 +52,8 @@ extern int sim_test(int argc, char** argv);
 // extern int run_test(int argc, char** argv);
 #endif
 
+// DISABLE_IR_OUT and MICROCODE_CONTROL configure the core, see Sap2Core.hpp
+
 using namespace DCSim;
 using namespace Componenets;
 using namespace Vendor;
@@ -43,147 +61,136 @@ using namespace Atmel;
 
 
 // ==========================
-// Electrical Sources
+// The 8SAP2 CPU, the rest of the app refers to its parts by name
 
-SourcePin Source;
-GroundPin GND;
+Sap2Core core0;
+
+// Electrical Sources
+SourcePin& Source = core0.Source;
+GroundPin& GND = core0.GND;
 
-// ==========================
 // Electrical Nodes
+LazyNode& ground_node = core0.ground_node;
+LazyNode& source_node = core0.source_node;
 
-ElectricalNode ground_node;
-ElectricalNode source_node;
-
-ElectricalNode ME_node;
-ElectricalNode WE_node;
-ElectricalNode MCE_node;
-ElectricalNode LM_Node;
-ElectricalNode CP_Node;
-ElectricalNode LP_Node;
-ElectricalNode PE_Node;
-ElectricalNode LI_Node;
-ElectricalNode IE_Node;
-ElectricalNode CLK_Node;
-
-ElectricalNode RC1_Node;
-ElectricalNode RC2_Node;
-ElectricalNode RC3_Node;
-ElectricalNode RC4_Node;
-ElectricalNode RC5_Node;
-
-ElectricalNode OPCode[4];
-
-ElectricalNode NOPC4;
-
-ElectricalNode NME_node;
-ElectricalNode NWE_node;
-
-// Add ability to automatically add itself to global list?
-std::vector<ElectricalNode*> nodes = {
-    &ground_node,
-    &source_node,
-    &ME_node,
-    &WE_node,
-    &MCE_node,
-    &LM_Node,
-    &CP_Node,
-    &LP_Node,
-    &PE_Node,
-    &LI_Node,
-    &IE_Node,
-    &CLK_Node,
-    &RC1_Node,
-    &RC2_Node,
-    &RC3_Node,
-    &RC4_Node,
-    &RC5_Node,
-    &OPCode[0],
-    &OPCode[1],
-    &OPCode[2],
-    &OPCode[3],
-    &NOPC4,
-    &NME_node,
-    &NWE_node
-};
+LazyNode& ME_node = core0.ME_node;
+LazyNode& WE_node = core0.WE_node;
+LazyNode& MCE_node = core0.MCE_node;
+LazyNode& LM_Node = core0.LM_Node;
+LazyNode& CP_Node = core0.CP_Node;
+LazyNode& LP_Node = core0.LP_Node;
+LazyNode& PE_Node = core0.PE_Node;
+LazyNode& LI_Node = core0.LI_Node;
+LazyNode& IE_Node = core0.IE_Node;
+LazyNode& CLK_Node = core0.CLK_Node;
+
+LazyNode& RC1_Node = core0.RC1_Node;
+LazyNode& RC2_Node = core0.RC2_Node;
+LazyNode& RC3_Node = core0.RC3_Node;
+LazyNode& RC4_Node = core0.RC4_Node;
+LazyNode& RC5_Node = core0.RC5_Node;
+
+LazyNode (&OPCode)[4] = core0.OPCode;
+
+LazyNode& NOPC4 = core0.NOPC4;
+
+LazyNode& NME_node = core0.NME_node;
+LazyNode& NWE_node = core0.NWE_node;
 
-// ==========================
 // Components
+Latch& mar = core0.mar;
+Latch& ir = core0.ir;
+Buffer& irb = core0.irb;
+Buffer& pcb = core0.pcb;
+Counter& pc = core0.pc;
+RingCounter& rc = core0.rc;
+
+// Clock, Clk is driven from integer ticks by tickClock
+Clock& clk = core0.clk;
+TickClock tickClock;
+
+NotGate& Not_OE = core0.Not_OE;
+NotGate& Not_WE = core0.Not_WE;
+NotGate& Not_IRLe = core0.Not_IRLe;
+Decoder3to8& IRDecoderL = core0.IRDecoderL;
+Decoder3to8& IRDecoderH = core0.IRDecoderH;
+Buffer& Seq1Buffer = core0.Seq1Buffer;
+Buffer& Seq2Buffer = core0.Seq2Buffer;
+
+// Bus nodes
+Bus8bit& mainBus = core0.mainBus;
+Bus8bit& marBus = core0.marBus;
+Bus8bit& pcBus = core0.pcBus;
+Bus8bit& irBus = core0.irBus;
+Bus8bit& controlLBus = core0.controlLBus;
+Bus8bit& controlHBus = core0.controlHBus;
+
+// Cached pin group reads
+LazyPinGroup& IRDecoderL_Q = core0.IRDecoderL_Q;
+LazyPinGroup& IRDecoderH_Q = core0.IRDecoderH_Q;
+
+#ifdef MICROCODE_CONTROL
+MicrocodeRom& microcode = Sap2Core::microcode;
+AT28C64 (&ucode)[MICROCODE_LANES] = core0.ucode;
+LazyNode (&Control)[MICROCODE_BITS] = core0.Control;
+LazyPinGroup (&UCode_Q)[MICROCODE_LANES] = core0.UCode_Q;
+#endif
+
+// ==========================
+// Memory
 
 // EEPROM/SRAM
 AT28C64 eeprom;
 
-// Memory Address Register and Instruction Register
-Latch mar;
-Latch ir;
-
-// IR and PC bus buffers
-Buffer irb;
-Buffer pcb;
-
-// Program counter
-Counter pc;
-
-// Ring Counter
-RingCounter rc(5);
-
-// Clock
-Clock clk;
-
-NotGate Not_OE;
-NotGate Not_WE;
-NotGate Not_IRLe;
-
-// decoders
-Decoder3to8 IRDecoderL;
-Decoder3to8 IRDecoderH;
-
-// Instruction Control Logic
-// OR EEPROM Output Enable
-OrGate OrOE;
-
-// Buffer
-Buffer Seq1Buffer;
-Buffer Seq2Buffer;
-
-// Sequencing Logic 
-//OR gates
-
-std::vector<Component*> parts = {
-    &eeprom,
-    &mar,
-    &ir,
-    &irb,
-    &pc,
-    &pcb,
-    &rc,
-    &clk,
-    &Not_OE,
-    &Not_WE,
-    &Not_IRLe,
-    &IRDecoderL,
-    &IRDecoderH,
-    &Seq1Buffer,
-    &Seq2Buffer
-};
+// ==========================
+// Step lists, the core's plus memory (added in setup)
+
+std::vector<LazyNode*>& nodes = core0.nodes;
+std::vector<Component*>& parts = core0.parts;
+std::vector<Bus8bit*>& buses = core0.buses;
+
+// Part outputs that mark nodes dirty, filled by elaboration
+LazyDrivers lazyDrivers;
 
 // ==========================
-// Bus nodes
-Bus8bit mainBus;
-Bus8bit marBus;
-Bus8bit pcBus;
-Bus8bit irBus;
-
-Bus8bit controlLBus;
-Bus8bit controlHBus;
-
-std::vector<Bus8bit*> buses = {
-    &mainBus,
-    &marBus,
-    &pcBus,
-    &irBus,
-    &controlLBus,
-    &controlHBus
-};
+// Timing
+
+#ifdef TIMING_MODEL
+TimingModel timing;
+#endif
+
+// ==========================
+// Peripherals
+
+#define OUT_FILE "8SAP_out.csv"
+
+OutputStream outStream;
+OutputRegister outReg(outStream);
+
+// ==========================
+// Switching activity, profiled per opcode
+
+#ifdef ACTIVITY_STATS
+#define ACTIVITY_CSV    "8SAP_activity.csv"
+#define ACTIVITY_JSON   "8SAP_activity.json"
+
+ActivityMonitor activity(16);
+#endif
+
+// ==========================
+// Per-cycle state hash, compared against --golden <file> when given
+
+#ifdef STATE_HASH
+#define HASH_FILE "8SAP_hash.bin"
+
+StateHash stateHash;
+#endif
+
+// ==========================
+// Program image and recorded signals, see SimControl.hpp
+
+uint8_t program_image[SIM_EEPROM_SIZE];
+SignalTrace trace;
 
 int main(int argc, char** argv);
 
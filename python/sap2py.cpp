@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Python bindings, import sap2
+
+    Wraps SimControl.hpp. program and microcode() are writable memoryviews
+    over the load images, not the parts: the EEPROM sees edits to program
+    after load_program(cpu.program), the microcode ROMs were loaded once at
+    setup and never see them.
+
+    Tracing is off until enable_trace(), which keeps the last capacity
+    steps in a ring. trace() is a read-only view straight over the ring,
+    capacity long, that the next steps write into; trace_head is the index
+    of the oldest sample and trace_count the number recorded. enable_trace()
+    reallocates the ring, so views taken before it must not be read after.
+    trace_copy() returns a copy, oldest first, that stays valid however far
+    the circuit runs on.
+
+        import numpy as np, sap2
+        cpu = sap2.Circuit()
+        cpu.load_program(open("prog.bin", "rb").read())
+        cpu.enable_trace(4096)
+        cpu.run(1000)
+        clk = np.roll(np.asarray(cpu.trace("clk")), -cpu.trace_head)[:cpu.trace_count]
+*/
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/functional.h>
+#include <pybind11/stl.h>
+
+#include <SimControl.hpp>
+
+namespace py = pybind11;
+
+template <typename T>
+static py::memoryview view(T* data, size_t size, bool readonly)
+{
+    return py::memoryview::from_buffer(data, {(py::ssize_t)size}, {(py::ssize_t)sizeof(T)}, readonly);
+}
+
+// Read-only memoryview over the whole ring of one traced signal. Python
+// refuses a null buffer, so tracing off views an empty dummy
+template <typename T>
+static py::object traceView(std::vector<T>& sig)
+{
+    static T off[1];
+    return view(sig.empty() ? off : sig.data(), sig.size(), true);
+}
+
+// Owning memoryview over a copy of one traced signal
+template <typename T>
+static py::object traceCopy(const SignalTrace& t, const std::vector<T>& sig)
+{
+    std::vector<T> samples(t.size());
+    t.copy(sig, samples.data());
+    py::bytes raw((const char*)samples.data(), samples.size() * sizeof(T));
+    return py::memoryview(raw).attr("cast")(py::format_descriptor<T>::format());
+}
+
+// ==============================================
+// The circuit is global, so only one per process
+
+class Circuit
+{
+public:
+    explicit Circuit(bool verbose)
+    {
+        if (isSetup())
+        {
+            throw std::runtime_error("sap2: the circuit is already built in this process");
+        }
+        simVerbose(verbose);
+        setup();
+        captureOutputs();
+    }
+
+    void loadProgram(py::buffer program)
+    {
+        py::buffer_info info = program.request();
+        if ((info.ndim != 1) || (info.itemsize != 1) || (info.strides[0] != 1))
+        {
+            throw std::invalid_argument("sap2: program must be a contiguous byte buffer");
+        }
+        ::loadProgram((const uint8_t*)info.ptr, (size_t)info.size);
+    }
+
+    // Returns the number of rising clock edges
+    uint64_t run(uint64_t n_steps)
+    {
+        py::gil_scoped_release release;
+        uint64_t edges = 0;
+        for (uint64_t i = 0; i < n_steps; i++)
+        {
+            edges += simStep();
+        }
+        return edges;
+    }
+
+    // Returns the number of steps taken
+    uint64_t runUntilCycle(uint64_t cycle, uint64_t max_steps)
+    {
+        py::gil_scoped_release release;
+        uint64_t steps = 0;
+        while ((simCycles() < cycle) && (steps < max_steps))
+        {
+            simStep();
+            steps++;
+        }
+        return steps;
+    }
+
+    uint64_t runUntilTime(tick_t time_ps)
+    {
+        py::gil_scoped_release release;
+        uint64_t steps = 0;
+        while (simTime() < time_ps)
+        {
+            simStep();
+            steps++;
+        }
+        return steps;
+    }
+
+    // Predicate is checked after every rising edge
+    uint64_t runUntil(const std::function<bool()>& predicate, uint64_t max_steps)
+    {
+        uint64_t steps = 0;
+        while (steps < max_steps)
+        {
+            steps++;
+            if (simStep() && predicate())
+            {
+                break;
+            }
+        }
+        return steps;
+    }
+
+    int node(const std::string& name) const
+    {
+        int value = readNode(name.c_str());
+        if (value < 0)
+        {
+            throw py::key_error(name);
+        }
+        return value;
+    }
+
+    int bus(const std::string& name) const
+    {
+        int value = readBus(name.c_str());
+        if (value < 0)
+        {
+            throw py::key_error(name);
+        }
+        return value;
+    }
+
+    py::object trace(const std::string& name) const
+    {
+        SignalTrace& t = signalTrace();
+        if (name == "time")
+        {
+            return traceView(t.time);
+        }
+        if (name == "clk")
+        {
+            return traceView(t.clk);
+        }
+        return traceView(t.rc[rcIndex(name)]);
+    }
+
+    py::object traceCopy(const std::string& name) const
+    {
+        const SignalTrace& t = signalTrace();
+        if (name == "time")
+        {
+            return ::traceCopy(t, t.time);
+        }
+        if (name == "clk")
+        {
+            return ::traceCopy(t, t.clk);
+        }
+        return ::traceCopy(t, t.rc[rcIndex(name)]);
+    }
+
+    py::list outputs() const
+    {
+        py::list records;
+        for (const OutputRecord& r : takeOutputs())
+        {
+            records.append(py::make_tuple(r.cycle, r.port, r.value));
+        }
+        return records;
+    }
+
+    py::object microcode(int lane) const
+    {
+        uint8_t* image = microcodeImage(lane);
+        if (!image)
+        {
+            return py::none();
+        }
+        return view(image, SIM_EEPROM_SIZE, false);
+    }
+
+private:
+    static int rcIndex(const std::string& name)
+    {
+        for (int i = 0; i < SIM_RC_SIGNALS; i++)
+        {
+            if (name == "rc" + std::to_string(i + 1))
+            {
+                return i;
+            }
+        }
+        throw py::key_error(name);
+    }
+};
+
+PYBIND11_MODULE(sap2, m)
+{
+    m.doc() = "8SAP2 circuit simulation";
+
+    py::class_<Circuit>(m, "Circuit")
+        .def(py::init<bool>(), py::arg("verbose") = false)
+        .def("load_program", &Circuit::loadProgram, py::arg("program"))
+        .def("step", [](Circuit&) { return simStep(); }, "One timestep, True on a rising clock edge")
+        .def("run", &Circuit::run, py::arg("n_steps"))
+        .def("run_until_cycle", &Circuit::runUntilCycle, py::arg("cycle"), py::arg("max_steps") = UINT64_MAX)
+        .def("run_until_time", &Circuit::runUntilTime, py::arg("time_ps"))
+        .def("run_until", &Circuit::runUntil, py::arg("predicate"), py::arg("max_steps") = UINT64_MAX)
+        .def("node", &Circuit::node, py::arg("name"))
+        .def("bus", &Circuit::bus, py::arg("name"))
+        .def("enable_trace", [](Circuit&, size_t capacity) { signalTrace().setCapacity(capacity); },
+             py::arg("capacity") = 1 << 20, "Keep the last capacity steps, 0 turns tracing off")
+        .def("trace", &Circuit::trace, py::arg("name"), py::keep_alive<0, 1>(),
+             "Ring of time, clk, rc1 - rc5, oldest at trace_head, valid until enable_trace()")
+        .def("trace_copy", &Circuit::traceCopy, py::arg("name"), "Copy of time, clk, rc1 - rc5, oldest first")
+        .def("clear_trace", [](Circuit&) { signalTrace().clear(); })
+        .def_property_readonly("trace_head", [](const Circuit&) { return signalTrace().oldest(); })
+        .def_property_readonly("trace_count", [](const Circuit&) { return signalTrace().size(); })
+        .def_property_readonly("trace_dropped", [](const Circuit&) { return signalTrace().dropped(); })
+        .def("outputs", &Circuit::outputs, "(cycle, port, value) written since the last call")
+        .def("microcode", &Circuit::microcode, py::arg("lane"), py::keep_alive<0, 1>(),
+             "Lane image the ROMs were loaded from, None without MICROCODE_CONTROL")
+        .def_property_readonly("program",
+                               py::cpp_function([](const Circuit&) { return view(programImage(), SIM_EEPROM_SIZE, false); },
+                                                py::keep_alive<0, 1>()),
+                               "EEPROM load image, edits apply on load_program(program)")
+        .def_property_readonly("node_names", [](const Circuit&) { return nodeNames(); })
+        .def_property_readonly("bus_names", [](const Circuit&) { return busNames(); })
+        .def_property_readonly("pc", [](const Circuit&) { return readPc(); })
+        .def_property_readonly("mar", [](const Circuit&) { return readMar(); })
+        .def_property_readonly("ir", [](const Circuit&) { return readIr(); })
+        .def_property_readonly("out", [](const Circuit&) { return readOut(); })
+        .def_property_readonly("control_word", [](const Circuit&) { return readControlWord(); })
+        .def_property_readonly("time_ps", [](const Circuit&) { return simTime(); })
+        .def_property_readonly("timestep_ps", [](const Circuit&) { return simTimestep(); })
+        .def_property_readonly("period_ps", [](const Circuit&) { return simPeriod(); })
+        .def_property_readonly("steps", [](const Circuit&) { return simSteps(); })
+        .def_property_readonly("cycles", [](const Circuit&) { return simCycles(); });
+}
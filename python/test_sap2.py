@@ -0,0 +1,54 @@
+# Import test for the sap2 module, run by ctest with the module's directory
+import sys
+
+sys.path.insert(0, sys.argv[1])
+import sap2
+
+
+def oldest_first(cpu, name):
+    ring = list(cpu.trace(name))
+    head = cpu.trace_head
+    return (ring[head:] + ring[:head])[:cpu.trace_count]
+
+
+cpu = sap2.Circuit()
+
+# Off by default, stepping records nothing
+cpu.step()
+assert len(cpu.trace("clk")) == 0 and len(cpu.trace_copy("clk")) == 0
+assert cpu.trace_count == 0
+
+cpu.enable_trace(64)
+for _ in range(20):
+    cpu.step()
+
+# Views span the whole ring, the first trace_count samples are recorded
+clk = cpu.trace("clk")
+time = cpu.trace("time")
+assert len(clk) == 64 and len(time) == 64 and clk.readonly
+assert cpu.trace_head == 0 and cpu.trace_count == 20
+assert set(clk[:20]) <= {0, 1}
+assert all(b - a == cpu.timestep_ps for a, b in zip(time[:20], time[1:20]))
+for i in range(1, 6):
+    assert len(cpu.trace("rc%d" % i)) == 64
+    assert len(cpu.trace_copy("rc%d" % i)) == 20
+assert list(cpu.trace_copy("time")) == list(time[:20])
+
+# Bounded, views see later steps, copies keep theirs
+copy = cpu.trace_copy("time")
+cpu.run(100)
+assert cpu.trace_count == 64
+assert cpu.trace_head == (20 + 100) % 64
+assert cpu.trace_dropped == 20 + 100 - 64
+assert time[cpu.trace_head - 1] == cpu.time_ps - cpu.timestep_ps
+assert oldest_first(cpu, "time") == list(cpu.trace_copy("time"))
+assert len(copy) == 20 and copy[0] + 19 * cpu.timestep_ps == copy[19]
+
+# The program view is the load image, writable
+program = cpu.program
+assert not program.readonly and len(program) == 8192
+program[0] = 0x5A
+cpu.load_program(program)
+assert cpu.program[0] == 0x5A
+
+print("sap2 import test: ok")
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    SpscRing and OutputStream ordering
+
+    Records carry their sequence number in cycle. Whichever path delivers
+    them, the consumer thread, the producer draining inline when the ring
+    is full, or stop(), every record must arrive exactly once and in push
+    order. Small rings force the full paths, the binary file is checked
+    byte for byte.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <SpscRing.hpp>
+#include <OutputStream.hpp>
+
+static int failures = 0;
+
+static void check(const char* name, bool condition)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+}
+
+// Sequence check on the consumer side
+struct Sequence
+{
+    uint64_t next {0};
+    bool ordered {true};
+
+    void operator()(const OutputRecord* records, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            ordered = ordered && (records[i].cycle == next) && (records[i].value == (uint8_t)next);
+            next++;
+        }
+    }
+};
+
+static OutputRecord record(uint64_t i)
+{
+    return OutputRecord{i, 0, (uint8_t)i};
+}
+
+// ==============================================
+// SpscRing
+
+static void testRing()
+{
+    SpscRing<int> ring(5);
+    check("ring: capacity rounded up", ring.capacity() == 8);
+
+    int out[8];
+    int next = 0;
+    int expect = 0;
+    for (int round = 0; round < 100; round++)
+    {
+        // Fill to the brim, then pop an uneven amount so the indices wrap
+        while (ring.push(next))
+        {
+            next++;
+        }
+        check("ring: full at capacity", ring.size() == ring.capacity());
+
+        size_t n = ring.popBatch(out, 1 + round % 7);
+        for (size_t i = 0; i < n; i++)
+        {
+            check("ring: pop order", out[i] == expect++);
+        }
+    }
+    size_t n;
+    while ((n = ring.popBatch(out, 8)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            check("ring: drain order", out[i] == expect++);
+        }
+    }
+    check("ring: everything popped", expect == next);
+}
+
+// ==============================================
+// OutputStream
+
+static void testThreaded(size_t capacity, size_t batch, uint64_t n, const char* name)
+{
+    OutputStream stream(capacity, batch);
+    Sequence seq;
+    stream.toCallback([&seq](const OutputRecord* records, size_t count) { seq(records, count); });
+
+    stream.start();
+    for (uint64_t i = 0; i < n; i++)
+    {
+        stream.push(record(i));
+    }
+    stream.stop();
+
+    printf("%-20s | Records: %llu |\t Batches: %llu\n", name,
+           (unsigned long long)stream.consumed(), (unsigned long long)stream.batches());
+    check(name, seq.ordered && (seq.next == n) && (stream.consumed() == n) && (stream.produced() == n));
+}
+
+static void testInline()
+{
+    // No consumer thread, a full ring is drained by the producer
+    OutputStream stream(8, 4);
+    Sequence seq;
+    stream.toCallback([&seq](const OutputRecord* records, size_t count) { seq(records, count); });
+
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        stream.push(record(i));
+    }
+    check("inline: drained while full", stream.consumed() >= 1000 - 8);
+    check("inline: in order so far", seq.ordered);
+
+    stream.drain();
+    check("inline: everything delivered", seq.ordered && (seq.next == 1000) && (stream.consumed() == 1000));
+}
+
+static void testBinary()
+{
+    FILE* file = tmpfile();
+    if (!file)
+    {
+        printf("SKIP binary: no tmpfile\n");
+        return;
+    }
+
+    OutputStream stream(16, 4);
+    stream.toFile(file, true);
+    stream.push(OutputRecord{0x0102030405060708ULL, 3, 0xA5});
+    stream.push(OutputRecord{42, 1, 7});
+    stream.drain();
+    stream.toFile(nullptr);
+
+    // The detached file sees nothing more
+    stream.push(OutputRecord{99, 0, 0});
+    stream.drain();
+
+    uint8_t bytes[32];
+    rewind(file);
+    size_t size = fread(bytes, 1, sizeof(bytes), file);
+    fclose(file);
+    check("binary: 10 bytes a record", size == 20);
+
+    uint64_t cycle;
+    memcpy(&cycle, &bytes[0], sizeof(cycle));
+    check("binary: first record", (cycle == 0x0102030405060708ULL) && (bytes[8] == 3) && (bytes[9] == 0xA5));
+    memcpy(&cycle, &bytes[10], sizeof(cycle));
+    check("binary: second record", (cycle == 42) && (bytes[18] == 1) && (bytes[19] == 7));
+}
+
+int main()
+{
+    testRing();
+    testThreaded(1 << 16, 1024, 2000000, "threaded");
+    testThreaded(16, 4, 200000, "threaded, ring full");
+    testThreaded(1 << 16, 1024, 100, "threaded, part batch");
+    testInline();
+    testBinary();
+
+    printf("Output stream ordering |\t Failures: %d\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    Sap2BlockCache against the Sap2Cpu reference interpreter
+
+    Both engines run the same image from reset on their own Sap2Cpu. After
+    every run() call the architectural state, memory and the OUT stream
+    (value and cycle) must match. Random images cover fusion, partial
+    blocks and STR/STM over code, the fixed cases check self-modifying code
+    inside the executing block and invalidation from an outside write.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <Sap2Cpu.hpp>
+#include <Sap2BlockCache.hpp>
+
+// Records OUT in order
+class OutRecorder : public Peripheral
+{
+public:
+    void write(uint8_t offset, uint8_t value, uint64_t cycle) override
+    {
+        (void)offset;
+        records.push_back({cycle, 0, value});
+    }
+
+    std::vector<OutputRecord> records;
+};
+
+struct Engine
+{
+    Sap2Cpu cpu;
+    OutRecorder out;
+
+    explicit Engine(const uint8_t* image)
+    {
+        cpu.loadProgram(image, SAP2_MEM_SIZE);
+        cpu.outPort = &out;
+    }
+};
+
+static int failures = 0;
+
+static bool same(const char* name, const Engine& ref, const Engine& dut)
+{
+    const Sap2State_t& r = ref.cpu.state;
+    const Sap2State_t& d = dut.cpu.state;
+
+    bool ok = (r.a == d.a) && (r.b == d.b) && (r.pc == d.pc) && (r.ir == d.ir) &&
+              (r.mar == d.mar) && (r.out == d.out) && (r.zero == d.zero) &&
+              (r.carry == d.carry) && (r.halted == d.halted) &&
+              (r.cycles == d.cycles) && (r.instructions == d.instructions);
+    ok = ok && (memcmp(ref.cpu.mem, dut.cpu.mem, SAP2_MEM_SIZE) == 0);
+    ok = ok && (ref.out.records.size() == dut.out.records.size());
+    for (size_t i = 0; ok && i < ref.out.records.size(); i++)
+    {
+        ok = (ref.out.records[i].cycle == dut.out.records[i].cycle) &&
+             (ref.out.records[i].value == dut.out.records[i].value);
+    }
+
+    if (!ok)
+    {
+        printf("FAIL %s |\t ref: A %02X B %02X PC %02X IR %02X MAR %02X Z%d C%d H%d instr %llu |\t cache: A %02X B %02X PC %02X IR %02X MAR %02X Z%d C%d H%d instr %llu\n",
+               name, r.a, r.b, r.pc, r.ir, r.mar, r.zero, r.carry, r.halted, (unsigned long long)r.instructions,
+               d.a, d.b, d.pc, d.ir, d.mar, d.zero, d.carry, d.halted, (unsigned long long)d.instructions);
+        failures++;
+    }
+    return ok;
+}
+
+static void check(const char* name, bool condition)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+}
+
+// ==============================================
+// Random images
+
+static uint32_t rng_state = 0x8A5Cu;
+
+static uint32_t rng()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void testRandom(int n_programs, uint64_t budget, Sap2BlockCache& totals)
+{
+    for (int p = 0; p < n_programs; p++)
+    {
+        uint8_t image[SAP2_MEM_SIZE];
+        for (uint8_t& byte : image)
+        {
+            byte = (uint8_t)rng();
+        }
+
+        Engine ref(image);
+        Engine dut(image);
+        Sap2BlockCache cache(dut.cpu);
+
+        // Uneven slices so blocks are cut short by the budget too
+        uint64_t executed = 0;
+        while (executed < budget && !ref.cpu.state.halted)
+        {
+            uint64_t slice = 1 + rng() % 97;
+            uint64_t a = ref.cpu.run(slice);
+            uint64_t b = cache.run(slice);
+            executed += a;
+
+            check("random: retired count", a == b);
+            if (!same("random", ref, dut))
+            {
+                printf("    program %d after %llu instructions\n", p, (unsigned long long)executed);
+                return;
+            }
+        }
+
+        totals.translations += cache.translations;
+        totals.invalidations += cache.invalidations;
+        totals.fusedPairs += cache.fusedPairs;
+    }
+}
+
+// ==============================================
+// Self-modifying code
+
+static void testSelfModify()
+{
+    // STR 3 rewrites an instruction later in the block being executed
+    uint8_t image[SAP2_MEM_SIZE] = {0};
+    image[0] = (kOpLDA << 4) | 14;
+    image[1] = (kOpSTR << 4) | 3;
+    image[2] = (kOpNOP << 4);
+    image[3] = (kOpLDI << 4) | 1;
+    image[4] = (kOpOUT << 4);
+    image[5] = (kOpHLT << 4);
+    image[14] = (kOpLDI << 4) | 7;
+
+    Engine ref(image);
+    Engine dut(image);
+    Sap2BlockCache cache(dut.cpu);
+    ref.cpu.run(100);
+    cache.run(100);
+
+    same("self-modify in block", ref, dut);
+    check("self-modify in block: OUT 7", dut.cpu.state.out == 7);
+    check("self-modify in block: invalidated", cache.invalidations == 1);
+
+    // STM patches the loop body it jumps back into
+    uint8_t loop[SAP2_MEM_SIZE] = {0};
+    loop[0] = (kOpLDI << 4) | 8;        // A = 8, the patch address
+    loop[1] = (kOpLDB << 4) | 15;       // B = 0x0B, A + B = LDI 3
+    loop[2] = (kOpSTM << 4);            // mem[8] = A + B
+    loop[3] = (kOpJMP << 4) | 13;
+    loop[8] = (kOpLDI << 4) | 1;
+    loop[9] = (kOpOUT << 4);
+    loop[10] = (kOpHLT << 4);
+    loop[13] = 8;
+    loop[15] = 0x0B;
+
+    Engine ref2(loop);
+    Engine dut2(loop);
+    Sap2BlockCache cache2(dut2.cpu);
+
+    // Translate the target block first so the store has something to drop
+    dut2.cpu.state.pc = 8;
+    cache2.run(1);
+    dut2.cpu.reset();
+    dut2.out.records.clear();
+
+    ref2.cpu.run(100);
+    cache2.run(100);
+    same("self-modify other block", ref2, dut2);
+    check("self-modify other block: OUT 3", dut2.cpu.state.out == 3);
+    check("self-modify other block: invalidated", cache2.invalidations >= 1);
+}
+
+// ==============================================
+// Invalidation from outside the CPU
+
+static void testInvalidate()
+{
+    uint8_t image[SAP2_MEM_SIZE] = {0};
+    image[0] = (kOpLDI << 4) | 1;
+    image[1] = (kOpOUT << 4);
+    image[2] = (kOpHLT << 4);
+
+    Engine ref(image);
+    Engine dut(image);
+    Sap2BlockCache cache(dut.cpu);
+    ref.cpu.run(100);
+    cache.run(100);
+    same("invalidate: first run", ref, dut);
+
+    // Same write on both, then rerun from reset
+    uint64_t translations = cache.translations;
+    ref.cpu.write(0, (kOpLDI << 4) | 9, 0);
+    dut.cpu.write(0, (kOpLDI << 4) | 9, 0);
+    check("invalidate: counted", cache.invalidations == 1);
+
+    ref.cpu.reset();
+    dut.cpu.reset();
+    ref.cpu.run(100);
+    cache.run(100);
+    same("invalidate: rerun", ref, dut);
+    check("invalidate: OUT 9", dut.cpu.state.out == 9);
+    check("invalidate: retranslated", cache.translations == translations + 1);
+
+    // A write outside any block drops nothing
+    dut.cpu.write(200, 0xFF, 0);
+    check("invalidate: data write ignored", cache.invalidations == 1);
+
+    // flush() drops everything, the next run translates again
+    cache.flush();
+    dut.cpu.reset();
+    cache.run(100);
+    check("invalidate: flush retranslates", cache.translations == translations + 2);
+}
+
+int main()
+{
+    Sap2Cpu scratch;
+    Sap2BlockCache totals(scratch);
+
+    testRandom(2000, 4000, totals);
+    testSelfModify();
+    testInvalidate();
+
+    // The fuzz is only useful if it reached the interesting paths
+    check("random: fused pairs", totals.fusedPairs > 0);
+    check("random: invalidations", totals.invalidations > 0);
+
+    printf("Block cache equivalence |\t Translations: %llu |\t Fused: %llu |\t Invalidations: %llu |\t Failures: %d\n",
+           (unsigned long long)totals.translations, (unsigned long long)totals.fusedPairs,
+           (unsigned long long)totals.invalidations, failures);
+
+    return failures ? 1 : 0;
+}
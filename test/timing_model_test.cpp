@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) GrissinoPublishing 2024
+ *
+ *  Licenced under MIT Open Source Licence
+ *
+ */
+
+/*
+    TimingModel edge accounting
+
+    A latch whose data D and enable LE are both launched by the clock. D
+    changes on edge 1 and LE falls on edge 2, so the arrival from edge 1 is
+    captured one period later and the minimum period is
+    tpd_max(D) + tsu - tpd_min(LE). If a probe reports its change on the
+    edge after the one that produced it, the same arrival spans two periods
+    and the reported frequency doubles, which is what clockEdge() callers
+    must avoid. Data launched by the capturing edge itself is a hold check.
+*/
+
+#include <cmath>
+#include <cstdio>
+
+#include <TimingModel.hpp>
+
+static int failures = 0;
+
+static void check(const char* name, bool condition)
+{
+    if (!condition)
+    {
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+}
+
+struct Latch
+{
+    TimingModel model;
+    int d_val {0};
+    int le_val {0};
+    int clk;
+
+    Latch()
+    {
+        clk = model.addSignal("CLK");
+        int d = model.addSignal("D", [this]{ return d_val; });
+        int le = model.addSignal("LE", [this]{ return le_val; });
+        model.addLaunch(clk, d, Datasheet::HC164_Ring);
+        model.addLaunch(clk, le, Datasheet::HC164_Ring);
+        model.addCheck("Q.D <- LE", d, le, TimingModel::kFallingEdge, Datasheet::HC573_Latch);
+    }
+
+    void edge(int n, int d, int le)
+    {
+        d_val = d;
+        le_val = le;
+        model.clockEdge(clk, 1000 * (uint64_t)(n - 1));
+    }
+};
+
+// tpd_max(D) + tsu - tpd_min(LE) over the number of periods between them
+static double minPeriod(int periods)
+{
+    return (double)(Datasheet::HC164_Ring.tpd_max + Datasheet::HC573_Latch.tsu - Datasheet::HC164_Ring.tpd_min) / periods;
+}
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) < 1e-6 * b;
+}
+
+static void testNextEdge()
+{
+    Latch t;
+    t.edge(1, 1, 1);        // D launched, LE rises
+    t.edge(2, 1, 0);        // LE falls, captures edge 1's D
+
+    check("next edge: one period", near(t.model.maxSafeFrequency(), 1e9 / minPeriod(1)));
+    check("next edge: no setup violation", t.model.setupViolations() == 0);
+    check("next edge: no hold violation", t.model.holdViolations() == 0);
+}
+
+static void testLateProbe()
+{
+    // LE's fall reported one edge late, the arrival spans two periods
+    Latch t;
+    t.edge(1, 1, 1);
+    t.edge(2, 1, 1);
+    t.edge(3, 1, 0);
+
+    check("late probe: two periods", near(t.model.maxSafeFrequency(), 1e9 / minPeriod(2)));
+}
+
+static void testSameEdge()
+{
+    // D changes on the edge LE falls: not captured by it, a hold violation
+    Latch t;
+    t.edge(1, 0, 1);
+    t.edge(2, 1, 0);
+
+    check("same edge: not a setup path", t.model.maxSafeFrequency() == 0);
+    check("same edge: hold violation", t.model.holdViolations() == 1);
+
+    // The next falling LE captures it, two periods later
+    t.edge(3, 1, 1);
+    t.edge(4, 1, 0);
+    check("same edge: captured later", near(t.model.maxSafeFrequency(), 1e9 / minPeriod(2)));
+}
+
+int main()
+{
+    testNextEdge();
+    testLateProbe();
+    testSameEdge();
+
+    printf("Timing model edges |\t Failures: %d\n", failures);
+    return failures ? 1 : 0;
+}